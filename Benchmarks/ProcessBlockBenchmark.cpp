@@ -0,0 +1,330 @@
+/*
+  ==============================================================================
+
+    Headless processBlock benchmark for FilteredDelayAudioProcessor.
+
+    Prints one CSV row per scenario, precision, sample rate and block size so
+    the numbers can be diffed between releases:
+
+        scenario,precision,sample_rate,block_size,ns_per_sample,realtime_factor,p99_block_us,delay_memory_kb
+
+    delay_memory_kb is the delay memory the instance held while it ran: the
+    float (or double) rings, plus the compact history in the long_ scenarios.
+
+    Options:
+        --seconds=<s>       seconds of audio to time per row (default 2)
+        --scenario=<name>   only run the named scenario
+        --precision=<p>     only run "float" or "double" processing (default both)
+        --profile=<file>    write per-stage timings as CSV (needs a build with
+                            FILTERED_DELAY_PROFILING=1)
+
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+//==============================================================================
+struct BenchmarkPlayHead  : public juce::AudioPlayHead
+{
+    juce::Optional<PositionInfo> getPosition() const override
+    {
+        PositionInfo info;
+        info.setBpm (bpm);
+        info.setIsPlaying (true);
+        return info;
+    }
+
+    double bpm = 120.0;
+};
+
+struct Scenario
+{
+    juce::String name;
+    std::vector<std::pair<juce::String, float>> parameterValues;
+    float inputGain = 1.0f;
+    int numChannels = 2;
+    bool monoSource = false;
+};
+
+struct Result
+{
+    double nsPerSample = 0.0;
+    double realtimeFactor = 0.0;
+    double p99BlockMicroseconds = 0.0;
+    size_t delayMemoryBytes = 0;
+};
+
+constexpr double sampleRates[] { 44100.0, 48000.0, 96000.0, 192000.0 };
+constexpr int blockSizes[] { 16, 32, 64, 128, 256, 512, 1024, 2048 };
+constexpr int sourceLength = 65536;
+
+// Settings shared by every scenario; each scenario only lists what it changes.
+const std::vector<std::pair<juce::String, float>> baseValues
+{
+    { "BPM_SYNC", 0.0f },
+    { "SYNC_RATE_CHOICE", 3.0f },
+    { "RATE", 350.0f },
+    { "FEEDBACK", 0.5f },
+    { "SATURATION", 0.0f },
+    { "DRIVE", 6.0f },
+    { "WIDTH", 2.5f },
+    { "MIX", 0.5f },
+    { "FILTER_TYPE", 0.0f },
+    { "CUTOFF", 2000.0f },
+    { "RESONANCE", 0.7f },
+    { "MOD_BP", 1.0f },
+    { "MOD_RATE", 1.0f },
+    { "MOD_DEPTH", 0.15f },
+    { "MOD_FB", 0.0f },
+    { "INTERPOLATION", 0.0f },
+    { "OVERSAMPLING", 0.0f },
+    { "OVERSAMPLING_FILTER", 0.0f },
+    { "TAP_COUNT", 0.0f },
+    { "TAP_SPACING", 125.0f },
+    { "TAP_SYNC", 0.0f },
+    { "TAP_DECAY", 0.7f },
+    { "TAP_SPREAD", 0.5f },
+    { "PARALLEL_CHANNELS", 0.0f },
+    { "LONG_DELAY", 0.0f },
+    { "LONG_RATE", 5000.0f },
+    { "LFO1_RATE", 0.5f },
+    { "LFO2_RATE", 2.0f },
+    { "MOD1_SOURCE", 0.0f },
+    { "MOD2_SOURCE", 0.0f },
+    { "MOD3_SOURCE", 0.0f },
+    { "MOD4_SOURCE", 0.0f }
+};
+
+const std::vector<Scenario> scenarios
+{
+    { "free",          {} },
+    { "sync",          { { "BPM_SYNC", 1.0f } } },
+    { "mod",           { { "MOD_BP", 0.0f } } },
+    { "mod_feedback",  { { "MOD_BP", 0.0f }, { "MOD_FB", 0.3f } } },
+    { "high_feedback", { { "FEEDBACK", 0.95f } } },
+    { "lowpass",       { { "FILTER_TYPE", 0.0f } } },
+    { "highpass",      { { "FILTER_TYPE", 1.0f } } },
+    { "bandpass",      { { "FILTER_TYPE", 2.0f } } },
+    { "interp_linear",   { { "INTERPOLATION", 0.0f } } },
+    { "interp_lagrange", { { "INTERPOLATION", 1.0f } } },
+    { "interp_thiran",   { { "INTERPOLATION", 2.0f } } },
+    { "interp_sinc",     { { "INTERPOLATION", 3.0f } } },
+    { "os_2x_iir",     { { "OVERSAMPLING", 1.0f } } },
+    { "os_4x_iir",     { { "OVERSAMPLING", 2.0f } } },
+    { "os_4x_fir",     { { "OVERSAMPLING", 2.0f }, { "OVERSAMPLING_FILTER", 1.0f } } },
+    { "taps_4",        { { "TAP_COUNT", 4.0f } } },
+    { "taps_16",       { { "TAP_COUNT", 16.0f } } },
+    { "taps_16_sync",  { { "TAP_COUNT", 16.0f }, { "TAP_SYNC", 1.0f } } },
+    { "silence",       {}, 0.0f },
+    { "surround_7_1_4", {}, 1.0f, 12 },
+    { "surround_7_1_4_parallel", { { "PARALLEL_CHANNELS", 1.0f } }, 1.0f, 12 },
+    { "mono_source",   { { "WIDTH", 0.0f } }, 1.0f, 2, true },
+    { "matrix_cutoff", { { "MOD1_SOURCE", 1.0f }, { "MOD1_DEST", 0.0f }, { "MOD1_AMOUNT", 0.5f } } },
+    { "matrix_all",    { { "MOD1_SOURCE", 1.0f }, { "MOD1_DEST", 0.0f }, { "MOD1_AMOUNT", 0.5f },
+                         { "MOD2_SOURCE", 2.0f }, { "MOD2_DEST", 1.0f }, { "MOD2_AMOUNT", 0.3f },
+                         { "MOD3_SOURCE", 3.0f }, { "MOD3_DEST", 2.0f }, { "MOD3_AMOUNT", 0.2f },
+                         { "MOD4_SOURCE", 1.0f }, { "MOD4_DEST", 3.0f }, { "MOD4_AMOUNT", 0.5f } } },
+    { "long_5s",       { { "LONG_DELAY", 1.0f }, { "LONG_RATE", 5000.0f } } },
+    { "long_30s",      { { "LONG_DELAY", 1.0f }, { "LONG_RATE", 30000.0f } } },
+    { "long_30s_sinc", { { "LONG_DELAY", 1.0f }, { "LONG_RATE", 30000.0f }, { "INTERPOLATION", 3.0f } } },
+    { "sat_tape",      { { "SATURATION", 1.0f }, { "FEEDBACK", 0.95f } } },
+    { "sat_hard",      { { "SATURATION", 3.0f }, { "FEEDBACK", 0.95f }, { "DRIVE", 18.0f } } }
+};
+
+//==============================================================================
+bool setParameter (juce::AudioProcessor& processor, const juce::String& parameterID, float value)
+{
+    for (auto* parameter : processor.getParameters())
+    {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter))
+        {
+            if (ranged->getParameterID() == parameterID)
+            {
+                ranged->setValueNotifyingHost (ranged->convertTo0to1 (value));
+                return true;
+            }
+        }
+    }
+
+    std::cerr << "Unknown parameter: " << parameterID << std::endl;
+    return false;
+}
+
+template <typename SampleType>
+juce::AudioBuffer<SampleType> makeSource()
+{
+    juce::AudioBuffer<SampleType> source (2, sourceLength);
+    juce::Random random (0x5eed);
+
+    for (int channel = 0; channel < source.getNumChannels(); ++channel)
+        for (int sample = 0; sample < sourceLength; ++sample)
+            source.setSample (channel, sample, static_cast<SampleType> ((random.nextFloat() * 2.0f - 1.0f) * 0.25f));
+
+    return source;
+}
+
+template <typename SampleType>
+Result run (const Scenario& scenario, double sampleRate, int blockSize, double seconds,
+            const juce::AudioBuffer<SampleType>& source, BenchmarkPlayHead& playHead,
+            juce::OutputStream* profileStream)
+{
+    constexpr auto isDouble = std::is_same_v<SampleType, double>;
+
+    // A fresh instance per row, so no state leaks between configurations.
+    FilteredDelayAudioProcessor processor;
+    processor.setPlayHead (&playHead);
+    processor.setProcessingPrecision (isDouble ? juce::AudioProcessor::doublePrecision
+                                               : juce::AudioProcessor::singlePrecision);
+    processor.setPlayConfigDetails (scenario.numChannels, scenario.numChannels, sampleRate, blockSize);
+
+    // Set before preparing, as a session load would, so prepareToPlay
+    // allocates the long delay history itself rather than leaving it to the
+    // message thread, which never runs here.
+    for (const auto& [parameterID, value] : baseValues)
+        setParameter (processor, parameterID, value);
+
+    for (const auto& [parameterID, value] : scenario.parameterValues)
+        setParameter (processor, parameterID, value);
+
+    processor.prepareToPlay (sampleRate, blockSize);
+
+    juce::AudioBuffer<SampleType> buffer (scenario.numChannels, blockSize);
+    juce::MidiBuffer midi;
+    int sourcePosition = 0;
+
+    auto nextBlock = [&]
+    {
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            buffer.copyFrom (channel, 0, source, scenario.monoSource ? 0 : channel % source.getNumChannels(), sourcePosition, blockSize);
+
+        buffer.applyGain (static_cast<SampleType> (scenario.inputGain));
+        sourcePosition = (sourcePosition + blockSize) % sourceLength;
+    };
+
+    const auto numBlocks = juce::jmax (1, (int) (seconds * sampleRate / blockSize));
+    const auto numWarmupBlocks = juce::jmax (1, numBlocks / 10);
+
+    for (int block = 0; block < numWarmupBlocks; ++block)
+    {
+        nextBlock();
+        processor.processBlock (buffer, midi);
+    }
+
+    std::vector<double> blockNanoseconds;
+    blockNanoseconds.reserve ((size_t) numBlocks);
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        nextBlock();
+
+        const auto start = std::chrono::steady_clock::now();
+        processor.processBlock (buffer, midi);
+        const auto end = std::chrono::steady_clock::now();
+
+        blockNanoseconds.push_back ((double) std::chrono::duration_cast<std::chrono::nanoseconds> (end - start).count());
+    }
+
+    if (profileStream != nullptr)
+        processor.getProfiler().writeSnapshots (*profileStream, scenario.name + ',' + (isDouble ? "double," : "float,")
+                                                                    + juce::String (sampleRate) + ',' + juce::String (blockSize) + ',');
+
+    const auto delayMemoryBytes = processor.getDelayMemoryUsageInBytes();
+    processor.releaseResources();
+
+    const auto totalNanoseconds = std::accumulate (blockNanoseconds.begin(), blockNanoseconds.end(), 0.0);
+    const auto numSamples = (double) numBlocks * blockSize;
+
+    std::sort (blockNanoseconds.begin(), blockNanoseconds.end());
+    const auto p99Index = juce::jmin (blockNanoseconds.size() - 1, (size_t) (0.99 * (double) blockNanoseconds.size()));
+
+    Result result;
+    result.nsPerSample = totalNanoseconds / numSamples;
+    result.realtimeFactor = (numSamples / sampleRate) / (totalNanoseconds * 1.0e-9);
+    result.p99BlockMicroseconds = blockNanoseconds[p99Index] * 1.0e-3;
+    result.delayMemoryBytes = delayMemoryBytes;
+    return result;
+}
+} // namespace
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    const auto seconds = args.containsOption ("--seconds") ? args.getValueForOption ("--seconds").getDoubleValue() : 2.0;
+    const auto scenarioFilter = args.getValueForOption ("--scenario");
+    const auto precisionFilter = args.getValueForOption ("--precision");
+
+    if (precisionFilter.isNotEmpty() && precisionFilter != "float" && precisionFilter != "double")
+    {
+        std::cerr << "--precision must be float or double" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<juce::FileOutputStream> profileStream;
+
+    if (args.containsOption ("--profile"))
+    {
+       #if FILTERED_DELAY_PROFILING
+        profileStream = args.getFileForOption ("--profile").createOutputStream();
+
+        if (profileStream == nullptr || ! profileStream->setPosition (0) || ! profileStream->truncate().wasOk())
+        {
+            std::cerr << "Can't write the profile file" << std::endl;
+            return 1;
+        }
+
+        *profileStream << "scenario,precision,sample_rate,block_size," << ProcessProfiler::getCsvHeader() << juce::newLine;
+       #else
+        std::cerr << "--profile needs a build with FILTERED_DELAY_PROFILING=1" << std::endl;
+        return 1;
+       #endif
+    }
+
+    const auto floatSource = makeSource<float>();
+    const auto doubleSource = makeSource<double>();
+    BenchmarkPlayHead playHead;
+
+    std::cout << "scenario,precision,sample_rate,block_size,ns_per_sample,realtime_factor,p99_block_us,delay_memory_kb" << std::endl;
+
+    for (const auto& scenario : scenarios)
+    {
+        if (scenarioFilter.isNotEmpty() && scenarioFilter != scenario.name)
+            continue;
+
+        for (const juce::String precision : { "float", "double" })
+        {
+            if (precisionFilter.isNotEmpty() && precisionFilter != precision)
+                continue;
+
+            for (auto sampleRate : sampleRates)
+            {
+                for (auto blockSize : blockSizes)
+                {
+                    const auto result = precision == "double"
+                        ? run (scenario, sampleRate, blockSize, seconds, doubleSource, playHead, profileStream.get())
+                        : run (scenario, sampleRate, blockSize, seconds, floatSource, playHead, profileStream.get());
+
+                    std::cout << scenario.name << ','
+                              << precision << ','
+                              << sampleRate << ','
+                              << blockSize << ','
+                              << result.nsPerSample << ','
+                              << result.realtimeFactor << ','
+                              << result.p99BlockMicroseconds << ','
+                              << result.delayMemoryBytes / 1024 << std::endl;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    Headless session-load benchmark for FilteredDelayAudioProcessor.
+
+    Creates a session's worth of instances and times each stage a host puts
+    them through, the way a large session load and the first seconds of
+    playback do. Prints one CSV row per precision and stage:
+
+        precision,stage,instances,total_ms,us_per_instance,delay_memory_kb
+
+    The stages are, in order:
+        construct       creating every instance
+        prepare         the first prepareToPlay
+        reprepare       prepareToPlay again with the same settings, as hosts
+                        do on transport and routing changes
+        resample        prepareToPlay at another sample rate
+        first_block     the first processBlock of noise through each instance
+        release         releaseResources
+        destroy         deleting every instance
+
+    delay_memory_kb is the delay memory the instances hold between them
+    after the stage.
+
+    Options:
+        --instances=<n>     instances per run (default 500)
+        --sample-rate=<hz>  the sample rate to prepare at (default 48000);
+                            resample uses 44100, or 48000 if that's the rate
+        --block-size=<n>    the block size to prepare at (default 512)
+        --precision=<p>     only run "float" or "double" processing (default both)
+
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+
+namespace
+{
+//==============================================================================
+struct Settings
+{
+    int numInstances = 500;
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+};
+
+using Instances = std::vector<std::unique_ptr<FilteredDelayAudioProcessor>>;
+
+size_t getDelayMemoryUsage (const Instances& instances)
+{
+    size_t bytes = 0;
+
+    for (const auto& instance : instances)
+        if (instance != nullptr)
+            bytes += instance->getDelayMemoryUsageInBytes();
+
+    return bytes;
+}
+
+template <typename SampleType>
+void run (const Settings& settings, const juce::String& precision)
+{
+    constexpr auto isDouble = std::is_same_v<SampleType, double>;
+
+    Instances instances ((size_t) settings.numInstances);
+
+    auto time = [&] (const juce::String& stage, const std::function<void (std::unique_ptr<FilteredDelayAudioProcessor>&)>& function)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        for (auto& instance : instances)
+            function (instance);
+
+        const auto end = std::chrono::steady_clock::now();
+        const auto totalMs = std::chrono::duration<double, std::milli> (end - start).count();
+
+        std::cout << precision << ','
+                  << stage << ','
+                  << settings.numInstances << ','
+                  << totalMs << ','
+                  << totalMs * 1000.0 / settings.numInstances << ','
+                  << getDelayMemoryUsage (instances) / 1024 << std::endl;
+    };
+
+    const auto otherSampleRate = settings.sampleRate == 44100.0 ? 48000.0 : 44100.0;
+
+    juce::AudioBuffer<SampleType> buffer (2, settings.blockSize);
+    juce::Random random (0x5eed);
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+            buffer.setSample (channel, sample, static_cast<SampleType> ((random.nextFloat() * 2.0f - 1.0f) * 0.25f));
+
+    juce::AudioBuffer<SampleType> block (2, settings.blockSize);
+    juce::MidiBuffer midi;
+
+    time ("construct", [&] (auto& instance)
+    {
+        instance = std::make_unique<FilteredDelayAudioProcessor>();
+    });
+
+    // As a host would before preparing; not part of the timing.
+    for (auto& instance : instances)
+    {
+        instance->setProcessingPrecision (isDouble ? juce::AudioProcessor::doublePrecision
+                                                   : juce::AudioProcessor::singlePrecision);
+        instance->setPlayConfigDetails (2, 2, settings.sampleRate, settings.blockSize);
+    }
+
+    time ("prepare", [&] (auto& instance)
+    {
+        instance->prepareToPlay (settings.sampleRate, settings.blockSize);
+    });
+
+    time ("reprepare", [&] (auto& instance)
+    {
+        instance->prepareToPlay (settings.sampleRate, settings.blockSize);
+    });
+
+    time ("resample", [&] (auto& instance)
+    {
+        instance->setRateAndBufferSizeDetails (otherSampleRate, settings.blockSize);
+        instance->prepareToPlay (otherSampleRate, settings.blockSize);
+    });
+
+    time ("first_block", [&] (auto& instance)
+    {
+        block.makeCopyOf (buffer, true);
+        instance->processBlock (block, midi);
+    });
+
+    time ("release", [&] (auto& instance)
+    {
+        instance->releaseResources();
+    });
+
+    time ("destroy", [&] (auto& instance)
+    {
+        instance.reset();
+    });
+}
+} // namespace
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    Settings settings;
+
+    if (args.containsOption ("--instances"))
+        settings.numInstances = args.getValueForOption ("--instances").getIntValue();
+
+    if (args.containsOption ("--sample-rate"))
+        settings.sampleRate = args.getValueForOption ("--sample-rate").getDoubleValue();
+
+    if (args.containsOption ("--block-size"))
+        settings.blockSize = args.getValueForOption ("--block-size").getIntValue();
+
+    const auto precisionFilter = args.getValueForOption ("--precision");
+
+    if (settings.numInstances < 1 || settings.sampleRate <= 0.0 || settings.blockSize < 1)
+    {
+        std::cerr << "--instances, --sample-rate and --block-size must be positive" << std::endl;
+        return 1;
+    }
+
+    if (precisionFilter.isNotEmpty() && precisionFilter != "float" && precisionFilter != "double")
+    {
+        std::cerr << "--precision must be float or double" << std::endl;
+        return 1;
+    }
+
+    std::cout << "precision,stage,instances,total_ms,us_per_instance,delay_memory_kb" << std::endl;
+
+    for (const juce::String precision : { "float", "double" })
+    {
+        if (precisionFilter.isNotEmpty() && precisionFilter != precision)
+            continue;
+
+        if (precision == "double")
+            run<double> (settings, precision);
+        else
+            run<float> (settings, precision);
+    }
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    AnalysisFeed.cpp
+
+    Downsampled wet-signal peaks, passed from the audio thread to the editor.
+
+  ==============================================================================
+*/
+
+#include "AnalysisFeed.h"
+
+//==============================================================================
+void AnalysisFeed::prepare (double sampleRate) noexcept
+{
+    // The FIFO itself is left alone: the message thread may be reading it.
+    hopLengthInSamples = juce::jmax (1, juce::roundToInt (sampleRate * hopSeconds));
+    samplesInHop = 0;
+    hopPeak = 0.0f;
+}
+
+float AnalysisFeed::getMeterLevel() noexcept
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    auto newestPeak = 0.0f;
+    const auto scope = fifo.read (fifo.getNumReady());
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        newestPeak = juce::jmax (newestPeak, peaks[(size_t) (scope.startIndex1 + i)]);
+
+    for (int i = 0; i < scope.blockSize2; ++i)
+        newestPeak = juce::jmax (newestPeak, peaks[(size_t) (scope.startIndex2 + i)]);
+
+    const auto nowMs = juce::Time::getMillisecondCounterHiRes();
+    const auto elapsedSeconds = juce::jlimit (0.0, 1.0, (nowMs - lastReadMs) * 0.001);
+    lastReadMs = nowMs;
+
+    meterLevel = juce::jmax (newestPeak, meterLevel * (float) std::exp (-elapsedSeconds / meterDecaySeconds));
+
+    // Let the level reach zero rather than decay through denormals forever.
+    if (meterLevel < 1.0e-6f)
+        meterLevel = 0.0f;
+
+    return meterLevel;
+}
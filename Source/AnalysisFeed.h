@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    AnalysisFeed.h
+
+    Downsampled wet-signal peaks, passed from the audio thread to the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Feeds the editor's level meter without costing the audio thread anything
+    beyond a compare and, every hopSeconds of audio, one FIFO write.
+
+    The audio thread hands in the peak of each block it has already measured.
+    Those are folded into one peak per hop and pushed through a lock-free
+    FIFO; when the FIFO is full (no editor open, or the message thread
+    stalled) the hop keeps accumulating instead, so no transient is lost.
+
+    The message thread drains the FIFO into a single decaying level. The decay
+    is worked out from the time since the last read, so any number of open
+    editors can ask for the level on every repaint and all see the same
+    value, and the FIFO is still only ever read from one thread.
+*/
+class AnalysisFeed
+{
+public:
+    static constexpr double hopSeconds = 0.01;
+    static constexpr double meterDecaySeconds = 0.15;    // time to fall to 1/e
+    static constexpr int fifoSize = 128;
+
+    //==============================================================================
+    /** Call before processing starts, like prepareToPlay. */
+    void prepare (double sampleRate) noexcept;
+
+    /** Audio thread: adds the peak level of the next numSamples of output. */
+    void pushPeak (float peak, int numSamples) noexcept
+    {
+        hopPeak = juce::jmax (hopPeak, peak);
+        samplesInHop += numSamples;
+
+        if (samplesInHop < hopLengthInSamples)
+            return;
+
+        // With the FIFO full (no editor reading it) the hop is dropped, so a
+        // meter opened later starts from recent peaks only.
+        const auto scope = fifo.write (1);
+
+        if (scope.blockSize1 > 0)
+            peaks[(size_t) scope.startIndex1] = hopPeak;
+
+        hopPeak = 0.0f;
+        samplesInHop = 0;
+    }
+
+    //==============================================================================
+    /** Message thread: the meter's level as a gain, with every waiting peak taken in. */
+    float getMeterLevel() noexcept;
+
+private:
+    //==============================================================================
+    juce::AbstractFifo fifo { fifoSize };
+    std::array<float, (size_t) fifoSize> peaks {};
+
+    // Audio thread only.
+    int hopLengthInSamples = 441;
+    int samplesInHop = 0;
+    float hopPeak = 0.0f;
+
+    // Message thread only.
+    float meterLevel = 0.0f;
+    double lastReadMs = 0.0;
+};
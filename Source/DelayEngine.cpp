@@ -0,0 +1,1067 @@
+/*
+  ==============================================================================
+
+    DelayEngine.cpp
+
+    The delay, filter and feedback loop at the heart of the plugin.
+
+  ==============================================================================
+*/
+
+#include "DelayEngine.h"
+
+//==============================================================================
+template <typename SampleType>
+void DelayEngine<SampleType>::prepare (const juce::dsp::ProcessSpec& spec, double maxDelayMs)
+{
+    sampleRate = spec.sampleRate;
+    maximumBlockSize = juce::jmax (1, (int) spec.maximumBlockSize);
+
+    // The read head swings either side of the longest delay, so the ring
+    // needs room for the full modulation depth on top of it. Taps read a
+    // whole chunk after it has been written, which needs a chunk more.
+    const auto maxChunkMs = maxChunkSize * 1000.0 / sampleRate;
+
+    delayBuffer.setSincTable (sincTable.get());
+    delayBuffer.prepare (sampleRate, maxDelayMs + maxModulationDepthMs + maxChunkMs);
+    delayHeadroomInSamples = maxChunkSize + static_cast<int> (std::ceil (maxModulationDepthMs / 1000.0 * sampleRate));
+    maxDelayInSamples = delayBuffer.getMaxDelayInSamples() - delayHeadroomInSamples;
+
+    updateOversampling();
+    taps.prepare (sampleRate);
+    saturator.prepare (sampleRate);
+    feedback.prepare (sampleRate, maximumBlockSize, feedbackRampSeconds);
+    delayLeft.prepare (sampleRate, maximumBlockSize, delayRampSeconds);
+    delayRight.prepare (sampleRate, maximumBlockSize, delayRampSeconds);
+    modulationDepthInSamples.reset (sampleRate, 0.05);
+
+    setModulationRate (modulationRateHz);
+    setDelay (delayLeft.getTargetValue(), delayRight.getTargetValue());
+
+    monoScratch.resize ((size_t) maximumBlockSize);
+    crossfadeLengthInSamples = juce::jmax (1, juce::roundToInt (crossfadeSeconds * sampleRate));
+
+    reset();
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::reset()
+{
+    delayBuffer.reset();
+    filter.reset();
+    saturator.reset();
+    taps.reset();
+
+    if (oversampler != nullptr)
+        oversampler->reset();
+    feedback.setCurrentAndTargetValue (feedback.getTargetValue());
+    delayLeft.setCurrentAndTargetValue (delayLeft.getTargetValue());
+    delayRight.setCurrentAndTargetValue (delayRight.getTargetValue());
+    allpassState = {};
+    lastOutput = {};
+
+    // The cleared ring holds nothing but identical lanes.
+    mirroredFrames = delayBuffer.getMaxDelayInSamples();
+    processMono = false;
+    rightLaneStale = false;
+
+    crossfadeStarting = false;
+    crossfadeSamplesLeft = 0;
+
+    // A filter change waiting for a crossfade that will now never run.
+    if (crossfadeFilterChanged)
+    {
+        filter.setCutoffFrequency (crossfadeCutoff);
+        filter.setResonance (crossfadeResonance);
+        crossfadeFilterChanged = false;
+    }
+
+    modulationDepthInSamples.setCurrentAndTargetValue (modulationRequested ? getModulationDepthInSamples() : 0);
+    modulationEnabled = modulationRequested;
+    lfoSin = 0;
+    lfoCos = 1;
+    lastModulatedTap = {};
+
+    controlDelayOffset = controlDelayTarget = controlDelayStep = {};
+    controlDelayMoving = false;
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::allocateLongDelay (double maxDelayMs)
+{
+    // The same headroom as the standard range.
+    delayBuffer.allocateLongRange (sampleRate, maxDelayMs + (delayHeadroomInSamples + 1) * 1000.0 / sampleRate);
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::setLongDelayEnabled (bool shouldBeEnabled) noexcept
+{
+    delayBuffer.setLongRangeEnabled (shouldBeEnabled);
+    maxDelayInSamples = delayBuffer.getMaxDelayInSamples() - delayHeadroomInSamples;
+
+    if (shouldBeEnabled)
+        return;
+
+    // Nothing may read beyond the float ring any more, so anything out there
+    // jumps back in rather than gliding through the history it's lost.
+    const auto maxDelay = static_cast<SampleType> (maxDelayInSamples);
+
+    for (auto* delay : { &delayLeft, &delayRight })
+        if (delay->getCurrentValue() > maxDelay || delay->getTargetValue() > maxDelay)
+            delay->setCurrentAndTargetValue (juce::jmin (maxDelay, delay->getTargetValue()));
+
+    crossfadeFromDelay = { { juce::jmin (maxDelay, crossfadeFromDelay[0]), juce::jmin (maxDelay, crossfadeFromDelay[1]) } };
+    taps.limitDelays (maxDelay);
+    mirroredFrames = juce::jmin (mirroredFrames, delayBuffer.getMaxDelayInSamples());
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::setInterpolation (DelayInterpolation newInterpolation) noexcept
+{
+    if (newInterpolation == interpolation)
+        return;
+
+    interpolation = newInterpolation;
+    allpassState = {};
+
+    // The windowed sinc needs a few frames of lookahead.
+    setDelay (delayLeft.getTargetValue(), delayRight.getTargetValue());
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::allocateOversampling (int order, bool useLinearPhase)
+{
+    order = juce::jmin (order, maxOversamplingOrder);
+
+    if (order <= 0)
+        return;
+
+    const auto index = getOversamplerIndex (order, useLinearPhase);
+
+    if (oversamplerReady[index].load (std::memory_order_acquire))
+        return;
+
+    // The half-band filters don't depend on the sample rate or the block
+    // size, only on the fixed chunk size, so each variant is only designed once.
+    oversamplers[index] = std::make_unique<Oversampler> ((size_t) 2, (size_t) order,
+                                                         useLinearPhase ? Oversampler::filterHalfBandFIREquiripple
+                                                                        : Oversampler::filterHalfBandPolyphaseIIR,
+                                                         true, false);
+    oversamplers[index]->initProcessing ((size_t) maxChunkSize);
+    oversamplerReady[index].store (true, std::memory_order_release);
+}
+
+template <typename SampleType>
+bool DelayEngine<SampleType>::setOversampling (int newOrder, bool useLinearPhase) noexcept
+{
+    newOrder = juce::jlimit (0, maxOversamplingOrder, newOrder);
+
+    if (newOrder == oversamplingOrder && useLinearPhase == oversamplingLinearPhase)
+        return true;
+
+    if (newOrder > 0 && ! oversamplerReady[getOversamplerIndex (newOrder, useLinearPhase)].load (std::memory_order_acquire))
+        return false;
+
+    oversamplingOrder = newOrder;
+    oversamplingLinearPhase = useLinearPhase;
+    updateOversampling();
+    return true;
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::updateOversampling() noexcept
+{
+    oversampler = oversamplingOrder > 0 ? oversamplers[getOversamplerIndex (oversamplingOrder, oversamplingLinearPhase)].get() : nullptr;
+
+    filter.prepare (sampleRate * (double) (1 << oversamplingOrder));
+
+    if (oversampler != nullptr)
+        oversampler->reset();
+
+    readOffset = oversampler != nullptr ? static_cast<SampleType> (oversampler->getLatencyInSamples()) : 0;
+
+    // The shortest delay depends on the read offset.
+    setDelay (delayLeft.getTargetValue(), delayRight.getTargetValue());
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::setSaturation (SaturationShape newShape, SampleType newDrive) noexcept
+{
+    // While it was off, lastOutput went round unsaturated, so that's the
+    // saturator's previous input.
+    if (! saturator.isActive() && newShape != SaturationShape::off)
+        saturator.startFrom (lastOutput);
+
+    saturator.setShape (newShape);
+    saturator.setDrive (newDrive);
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::setModulationEnabled (bool shouldBeEnabled) noexcept
+{
+    modulationRequested = shouldBeEnabled;
+
+    // Switching off ramps the depth down first; process() drops out of the
+    // modulated path once it reaches zero.
+    modulationDepthInSamples.setTargetValue (shouldBeEnabled ? getModulationDepthInSamples() : 0);
+
+    if (shouldBeEnabled)
+        modulationEnabled = true;
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::setModulationRate (SampleType newRateHz) noexcept
+{
+    modulationRateHz = newRateHz;
+
+    const auto increment = juce::MathConstants<double>::twoPi * modulationRateHz / sampleRate;
+    lfoRotationSin = static_cast<SampleType> (std::sin (increment));
+    lfoRotationCos = static_cast<SampleType> (std::cos (increment));
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::setModulationDepth (SampleType newDepth) noexcept
+{
+    modulationDepth = newDepth;
+
+    if (modulationRequested)
+        modulationDepthInSamples.setTargetValue (getModulationDepthInSamples());
+}
+
+template <typename SampleType>
+SampleType DelayEngine<SampleType>::getModulationDepthInSamples() const noexcept
+{
+    return static_cast<SampleType> (modulationDepth * maxModulationDepthMs / 1000.0 * sampleRate);
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::setCutoffFrequency (SampleType newCutoffHz)
+{
+    taps.setCutoffFrequency (newCutoffHz);
+
+    if (crossfadeStarting)
+    {
+        crossfadeCutoff = newCutoffHz;
+        crossfadeFilterChanged = true;
+        return;
+    }
+
+    filter.setCutoffFrequency (newCutoffHz);
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::setResonance (SampleType newResonance)
+{
+    taps.setResonance (newResonance);
+
+    if (crossfadeStarting)
+    {
+        crossfadeResonance = newResonance;
+        crossfadeFilterChanged = true;
+        return;
+    }
+
+    filter.setResonance (newResonance);
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::setDelay (SampleType newDelayLeft, SampleType newDelayRight) noexcept
+{
+    const auto minDelay = static_cast<SampleType> (getInterpolationLookahead (interpolation)) + readOffset;
+    const auto maxDelay = static_cast<SampleType> (getMaxDelayInSamples());
+
+    newDelayLeft  = juce::jlimit (minDelay, maxDelay, newDelayLeft);
+    newDelayRight = juce::jlimit (minDelay, maxDelay, newDelayRight);
+
+    if (crossfadeStarting)
+    {
+        delayLeft.setCurrentAndTargetValue (newDelayLeft);
+        delayRight.setCurrentAndTargetValue (newDelayRight);
+        return;
+    }
+
+    delayLeft.setTargetValue  (newDelayLeft);
+    delayRight.setTargetValue (newDelayRight);
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::startCrossfade() noexcept
+{
+    // The heads being read now become the old ones. A crossfade that is still
+    // running is cut short, from the heads it was fading to.
+    crossfadeFromDelay = { { delayLeft.getCurrentValue(), delayRight.getCurrentValue() } };
+    crossfadeAllpassState = allpassState;
+    crossfadeFromType = filter.getType();
+
+    // Calling this twice before process() keeps the filter changes made in between.
+    if (! crossfadeStarting)
+    {
+        crossfadeCutoff = filter.getCutoffFrequency();
+        crossfadeResonance = filter.getResonance();
+    }
+
+    crossfadeStarting = true;
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::setTap (int index, SampleType delayInSamples, SampleType gain, SampleType pan) noexcept
+{
+    // Taps read after the write, so they only need the longest lookahead of any mode.
+    const auto minDelay = static_cast<SampleType> (getInterpolationLookahead (DelayInterpolation::windowedSinc));
+    const auto maxDelay = static_cast<SampleType> (getMaxDelayInSamples());
+
+    taps.setTap (index, juce::jlimit (minDelay, maxDelay, delayInSamples), gain, pan);
+}
+
+//==============================================================================
+template <typename SampleType>
+void DelayEngine<SampleType>::process (const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept
+{
+    const auto& block = context.getOutputBlock();
+    const auto numSamples = (int) block.getNumSamples();
+
+    if (block.getNumChannels() == 0 || numSamples == 0)
+        return;
+
+    auto* left = block.getChannelPointer (0);
+    auto* right = block.getNumChannels() > 1 ? block.getChannelPointer (1) : nullptr;
+
+    if (control == nullptr)
+    {
+        controlDelayOffset = controlDelayTarget = controlDelayStep = {};
+        controlDelayMoving = false;
+    }
+
+    // The ramps render at most one prepared block at a time, and control
+    // modulation moves on once per interval.
+    const auto stepSize = control != nullptr ? juce::jlimit (1, maximumBlockSize, control->intervalLength) : maximumBlockSize;
+
+    for (int start = 0, interval = 0; start < numSamples; start += stepSize, ++interval)
+    {
+        const auto blockSize = juce::jmin (stepSize, numSamples - start);
+
+        if (crossfadeStarting)
+        {
+            crossfadeStarting = false;
+            crossfadeSamplesLeft = crossfadeLengthInSamples;
+
+            // The filter runs 2^order times per frame when oversampled.
+            if (crossfadeFilterChanged)
+            {
+                filter.glideTo (crossfadeCutoff, crossfadeResonance, crossfadeLengthInSamples << oversamplingOrder);
+                crossfadeFilterChanged = false;
+            }
+        }
+
+        if (control != nullptr)
+            applyControlInterval (interval, blockSize);
+
+        // Ramps are linear, so the shortest delay in the block is at one end,
+        // and so are the control offsets within an interval.
+        shortestDelayInBlock = juce::jmin (juce::jmin (delayLeft.getCurrentValue(), delayLeft.getTargetValue()),
+                                           juce::jmin (delayRight.getCurrentValue(), delayRight.getTargetValue()))
+                             - readOffset;
+
+        if (controlDelayMoving)
+            shortestDelayInBlock += juce::jmin (SampleType(), juce::jmin (juce::jmin (controlDelayOffset[0], controlDelayOffset[1]),
+                                                                          juce::jmin (controlDelayTarget[0], controlDelayTarget[1])));
+
+        auto* channel = left + start;
+        const auto* inputRight = right != nullptr ? right + start : channel;
+        auto* outputRight = right != nullptr ? right + start : monoScratch.data();
+
+        processMono = canProcessAsMono (channel, inputRight, blockSize);
+
+        if (! processMono)
+            syncRightLane();
+
+        feedbackValues   = feedback.getNextBlock (blockSize);
+        delayLeftValues  = delayLeft.getNextBlock (blockSize);
+        delayRightValues = delayRight.getNextBlock (blockSize);
+
+        auto numCrossfaded = 0;
+
+        if (crossfadeSamplesLeft > 0)
+        {
+            numCrossfaded = juce::jmin (blockSize, crossfadeSamplesLeft);
+            processCrossfade (channel, inputRight, channel, outputRight, numCrossfaded);
+            crossfadeSamplesLeft -= numCrossfaded;
+        }
+
+        if (numCrossfaded < blockSize)
+            processFrames (channel + numCrossfaded, inputRight + numCrossfaded, channel + numCrossfaded,
+                           outputRight + numCrossfaded, blockSize - numCrossfaded);
+    }
+
+    control = nullptr;
+    delayBuffer.archive();
+
+    filter.snapToZero();
+    taps.snapToZero();
+
+    if (modulationEnabled)
+    {
+        // The rotating phasor slowly drifts off the unit circle; pull it back once per block.
+        const auto magnitudeCorrection = static_cast<SampleType> (1.5) - static_cast<SampleType> (0.5) * (lfoSin * lfoSin + lfoCos * lfoCos);
+        lfoSin *= magnitudeCorrection;
+        lfoCos *= magnitudeCorrection;
+
+        if (! modulationRequested && ! modulationDepthInSamples.isSmoothing())
+        {
+            modulationEnabled = false;
+            lastModulatedTap = {};
+        }
+    }
+}
+
+template <typename SampleType>
+bool DelayEngine<SampleType>::canProcessAsMono (const SampleType* inputLeft, const SampleType* inputRight, int numSamples) const noexcept
+{
+    if (oversampler != nullptr || modulationEnabled || crossfadeSamplesLeft > 0 || control != nullptr || filter.isGliding())
+        return false;
+
+    if (delayLeft.getCurrentValue() != delayRight.getCurrentValue() || delayLeft.getTargetValue() != delayRight.getTargetValue())
+        return false;
+
+    // Every frame the block reads, down to the oldest interpolation neighbour,
+    // must hold the same value in both lanes.
+    const auto longestDelay = juce::jmax (delayLeft.getCurrentValue(), delayLeft.getTargetValue());
+
+    if (mirroredFrames <= static_cast<int> (longestDelay) + getInterpolationLookbehind (interpolation))
+        return false;
+
+    if (! rightLaneStale && ! (filter.lanesMatch() && (! saturator.isActive() || saturator.lanesMatch()) && lastOutput[0] == lastOutput[1] && allpassState[0] == allpassState[1]))
+        return false;
+
+    return inputLeft == inputRight
+        || std::memcmp (inputLeft, inputRight, (size_t) numSamples * sizeof (SampleType)) == 0;
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::syncRightLane() noexcept
+{
+    if (! rightLaneStale)
+        return;
+
+    filter.mirrorLeftLane();
+    saturator.mirrorLeftLane();
+    lastOutput[1] = lastOutput[0];
+    allpassState[1] = allpassState[0];
+    rightLaneStale = false;
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::applyControlInterval (int interval, int numSamples) noexcept
+{
+    jassert (interval < control->numIntervals);
+
+    const auto cutoff = static_cast<SampleType> (control->cutoffHz[interval]);
+    const auto resonance = static_cast<SampleType> (control->resonance[interval]);
+
+    // The filter runs 2^order times per frame when oversampled. The taps only
+    // add to the output, so they just take each interval's values.
+    filter.glideTo (cutoff, resonance, numSamples << oversamplingOrder);
+    taps.setFilter (cutoff, resonance);
+
+    // Start from where the last interval was heading, so rounding in the
+    // steps never builds up.
+    controlDelayOffset = controlDelayTarget;
+    controlDelayTarget = { { static_cast<SampleType> (control->delayOffsetLeft[interval]),
+                             static_cast<SampleType> (control->delayOffsetRight[interval]) } };
+    controlDelayStep = (controlDelayTarget - controlDelayOffset) * (static_cast<SampleType> (1) / static_cast<SampleType> (numSamples));
+
+    controlDelayMoving = controlDelayOffset[0] != 0 || controlDelayOffset[1] != 0
+                      || controlDelayTarget[0] != 0 || controlDelayTarget[1] != 0;
+}
+
+template <typename SampleType>
+typename DelayEngine<SampleType>::Frame DelayEngine<SampleType>::getNextModulationOffsets() noexcept
+{
+    const auto depth = modulationDepthInSamples.getNextValue();
+
+    const auto nextSin = lfoSin * lfoRotationCos + lfoCos * lfoRotationSin;
+    lfoCos = lfoCos * lfoRotationCos - lfoSin * lfoRotationSin;
+    lfoSin = nextSin;
+
+    // Left and right sit a quarter cycle apart.
+    return { { depth * lfoSin, depth * lfoCos } };
+}
+
+template <typename SampleType>
+typename DelayEngine<SampleType>::Frame DelayEngine<SampleType>::getNextVariableDelays() noexcept
+{
+    Frame delays { { delayLeftValues  != nullptr ? *delayLeftValues++  : delayLeft.getCurrentValue(),
+                     delayRightValues != nullptr ? *delayRightValues++ : delayRight.getCurrentValue() } };
+
+    if (controlDelayMoving)
+    {
+        // Kept within the delay range; the LFO below has headroom of its own.
+        const auto maxDelay = static_cast<SampleType> (maxDelayInSamples);
+        controlDelayOffset = controlDelayOffset + controlDelayStep;
+        delays = delays + controlDelayOffset;
+        delays = { { juce::jmin (maxDelay, delays[0]), juce::jmin (maxDelay, delays[1]) } };
+    }
+
+    if (modulationEnabled)
+        delays = delays + getNextModulationOffsets();
+
+    delays = delays - Frame::fromScalar (readOffset);
+
+    const auto minDelay = static_cast<SampleType> (getInterpolationLookahead (interpolation));
+
+    return { { juce::jmax (minDelay, delays[0]), juce::jmax (minDelay, delays[1]) } };
+}
+
+template <typename SampleType>
+void DelayEngine<SampleType>::processFrames (const SampleType* inputLeft, const SampleType* inputRight,
+                                             SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept
+{
+    switch (filter.getType())
+    {
+        case FilterType::lowpass:   processFrames<FilterType::lowpass>  (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        case FilterType::highpass:  processFrames<FilterType::highpass> (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        case FilterType::bandpass:  processFrames<FilterType::bandpass> (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        default:                    jassertfalse; break;
+    }
+}
+
+template <typename SampleType>
+template <juce::dsp::StateVariableTPTFilterType type>
+void DelayEngine<SampleType>::processFrames (const SampleType* inputLeft, const SampleType* inputRight,
+                                             SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept
+{
+    using Mode = DelayInterpolation;
+
+    switch (interpolation)
+    {
+        case Mode::linear:        processFrames<type, Mode::linear>       (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        case Mode::lagrange3rd:   processFrames<type, Mode::lagrange3rd>  (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        case Mode::thiran:        processFrames<type, Mode::thiran>       (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        case Mode::windowedSinc:  processFrames<type, Mode::windowedSinc> (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        default:                  jassertfalse; break;
+    }
+}
+
+template <typename SampleType>
+template <juce::dsp::StateVariableTPTFilterType type, DelayInterpolation mode>
+void DelayEngine<SampleType>::processFrames (const SampleType* inputLeft, const SampleType* inputRight,
+                                             SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept
+{
+    if (modulationEnabled || controlDelayMoving || delayLeftValues != nullptr || delayRightValues != nullptr || readOffset != 0)
+        processFrames<type, mode, true>  (inputLeft, inputRight, outputLeft, outputRight, numSamples);
+    else
+        processFrames<type, mode, false> (inputLeft, inputRight, outputLeft, outputRight, numSamples);
+}
+
+template <typename SampleType>
+template <juce::dsp::StateVariableTPTFilterType type, DelayInterpolation mode, bool variableDelay>
+void DelayEngine<SampleType>::processFrames (const SampleType* inputLeft, const SampleType* inputRight,
+                                             SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept
+{
+    auto shortestDelay = shortestDelayInBlock;
+
+    if (variableDelay && modulationEnabled)
+        shortestDelay -= juce::jmax (modulationDepthInSamples.getCurrentValue(), modulationDepthInSamples.getTargetValue());
+
+    // Longest chunk for which every read lands on frames written before it.
+    const auto chunkLimit = juce::jmin (maxChunkSize, static_cast<int> (shortestDelay) - getInterpolationLookahead (mode));
+
+    if (chunkLimit >= minChunkSize)
+    {
+        for (int start = 0; start < numSamples; start += chunkLimit)
+        {
+            const auto chunkSize = juce::jmin (chunkLimit, numSamples - start);
+
+            if (processMono)
+                processMonoChunk<type, mode, variableDelay> (inputLeft + start, outputLeft + start, outputRight + start, chunkSize);
+            else
+                processChunk<type, mode, variableDelay> (inputLeft + start, inputRight + start, outputLeft + start, outputRight + start, chunkSize);
+        }
+
+        return;
+    }
+
+    syncRightLane();
+
+    // The oversampler always sets a read offset, so its delays are variable.
+    if constexpr (variableDelay)
+    {
+        if (oversampler != nullptr)
+        {
+            processShortRuns<type, mode> (inputLeft, inputRight, outputLeft, outputRight, numSamples);
+            return;
+        }
+    }
+
+    processFrameByFrame<type, mode, variableDelay> (inputLeft, inputRight, outputLeft, outputRight, numSamples);
+}
+
+template <typename SampleType>
+template <juce::dsp::StateVariableTPTFilterType type, DelayInterpolation mode>
+void DelayEngine<SampleType>::processShortRuns (const SampleType* inputLeft, const SampleType* inputRight,
+                                                SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept
+{
+    const auto lookahead = getInterpolationLookahead (mode);
+
+    for (int start = 0; start < numSamples; start += maxChunkSize)
+    {
+        const auto numFrames = juce::jmin (maxChunkSize, numSamples - start);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const auto delays = getNextVariableDelays();
+            variableDelayLeft[(size_t) i]  = delays[0];
+            variableDelayRight[(size_t) i] = delays[1];
+        }
+
+        for (int i = 0; i < numFrames;)
+        {
+            // Frame n of a run may only read frames from before the run.
+            auto runLength = 0;
+
+            while (i + runLength < numFrames
+                   && static_cast<int> (juce::jmin (variableDelayLeft[(size_t) (i + runLength)], variableDelayRight[(size_t) (i + runLength)])) - lookahead > runLength)
+                ++runLength;
+
+            const auto offset = start + i;
+            const auto* delaysLeft  = variableDelayLeft.data() + i;
+            const auto* delaysRight = variableDelayRight.data() + i;
+
+            // A frame reading what it has just written goes on its own.
+            if (runLength == 0)
+            {
+                runLength = 1;
+                processFrameByFrame<type, mode, true> (inputLeft + offset, inputRight + offset, outputLeft + offset, outputRight + offset,
+                                                       runLength, delaysLeft, delaysRight);
+            }
+            else
+            {
+                processChunk<type, mode, true> (inputLeft + offset, inputRight + offset, outputLeft + offset, outputRight + offset,
+                                                runLength, delaysLeft, delaysRight);
+            }
+
+            i += runLength;
+        }
+    }
+}
+
+template <typename SampleType>
+template <juce::dsp::StateVariableTPTFilterType type, DelayInterpolation mode, bool variableDelay>
+void DelayEngine<SampleType>::processFrameByFrame (const SampleType* inputLeft, const SampleType* inputRight,
+                                                   SampleType* outputLeft, SampleType* outputRight, int numSamples,
+                                                   const SampleType* delaysLeft, const SampleType* delaysRight) noexcept
+{
+    juce::ignoreUnused (delaysLeft, delaysRight);
+
+    const auto feedbackScale = static_cast<SampleType> (0.5);
+    const auto* feedbackRamp = feedbackValues;
+    const auto settledFeedback = feedback.getCurrentValue();
+    const auto saturating = saturator.isActive();
+    const auto feedsTapBack = variableDelay && modulationEnabled;
+    auto last = lastOutput;
+    auto tap = lastModulatedTap;
+    auto mirrored = mirroredFrames;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const Frame input { { inputLeft[i], inputRight[i] } };
+        auto toDelay = input - last;
+        Frame delays { { delayLeft.getCurrentValue(), delayRight.getCurrentValue() } };
+
+        if constexpr (variableDelay)
+        {
+            delays = delaysLeft != nullptr ? Frame { { delaysLeft[i], delaysRight[i] } }
+                                           : getNextVariableDelays();
+
+            if (feedsTapBack)
+                toDelay = toDelay + tap * modulationFeedback;
+        }
+
+        delayBuffer.advance();
+        delayBuffer.writeFrame (toDelay);
+        mirrored = toDelay[0] == toDelay[1] ? mirrored + 1 : 0;
+
+        const auto delayed = delayBuffer.template readFrame<mode> (delays[0], delays[1], allpassState);
+
+        if (feedsTapBack)
+            tap = delayed;
+
+        auto wet = delayed;
+
+        if (oversampler != nullptr)
+        {
+            wetLeft[0]  = delayed[0];
+            wetRight[0] = delayed[1];
+            filterChunk<type> (1);
+            wet = { { wetLeft[0], wetRight[0] } };
+        }
+        else
+        {
+            wet = filter.template processFrameGliding<type> (delayed);
+        }
+
+        const auto output = wet + last;
+
+        outputLeft[i]  = output[0];
+        outputRight[i] = output[1];
+
+        taps.template process<type, mode> (delayBuffer, outputLeft + i, outputRight + i, 1);
+
+        last = output * ((feedbackRamp != nullptr ? feedbackRamp[i] : settledFeedback) * feedbackScale);
+
+        if (saturating)
+            last = saturator.process (last);
+    }
+
+    if (feedbackValues != nullptr)
+        feedbackValues += numSamples;
+
+    lastOutput = last;
+    lastModulatedTap = tap;
+    mirroredFrames = juce::jmin (mirrored, delayBuffer.getMaxDelayInSamples());
+}
+
+template <typename SampleType>
+template <juce::dsp::StateVariableTPTFilterType type, DelayInterpolation mode, bool variableDelay>
+void DelayEngine<SampleType>::processChunk (const SampleType* inputLeft, const SampleType* inputRight,
+                                            SampleType* outputLeft, SampleType* outputRight, int numSamples,
+                                            const SampleType* delaysLeft, const SampleType* delaysRight) noexcept
+{
+    jassert (numSamples <= maxChunkSize);
+
+    // Delayed signal for the whole chunk.
+    if constexpr (variableDelay)
+    {
+        if (delaysLeft == nullptr)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto delays = getNextVariableDelays();
+                variableDelayLeft[(size_t) i]  = delays[0];
+                variableDelayRight[(size_t) i] = delays[1];
+            }
+
+            delaysLeft  = variableDelayLeft.data();
+            delaysRight = variableDelayRight.data();
+        }
+
+        delayBuffer.template readBlock<mode> (0, delaysLeft,  wetLeft.data(),  numSamples, allpassState[0]);
+        delayBuffer.template readBlock<mode> (1, delaysRight, wetRight.data(), numSamples, allpassState[1]);
+
+        if (modulationEnabled)
+        {
+            // Modulation feedback: each frame takes the raw tap read one frame earlier.
+            writeLeft[0]  = lastModulatedTap[0] * modulationFeedback;
+            writeRight[0] = lastModulatedTap[1] * modulationFeedback;
+
+            for (int i = 1; i < numSamples; ++i)
+            {
+                writeLeft[(size_t) i]  = wetLeft[(size_t) (i - 1)]  * modulationFeedback;
+                writeRight[(size_t) i] = wetRight[(size_t) (i - 1)] * modulationFeedback;
+            }
+
+            lastModulatedTap = { { wetLeft[(size_t) (numSamples - 1)], wetRight[(size_t) (numSamples - 1)] } };
+        }
+        else
+        {
+            std::fill (writeLeft.begin(), writeLeft.begin() + numSamples, SampleType());
+            std::fill (writeRight.begin(), writeRight.begin() + numSamples, SampleType());
+        }
+    }
+    else
+    {
+        juce::ignoreUnused (delaysLeft, delaysRight);
+        delayBuffer.template readBlock<mode> (0, delayLeft.getCurrentValue(),  wetLeft.data(),  numSamples, allpassState[0]);
+        delayBuffer.template readBlock<mode> (1, delayRight.getCurrentValue(), wetRight.data(), numSamples, allpassState[1]);
+    }
+
+    filterChunk<type> (numSamples);
+
+    // Feedback recursion; the only stage that still depends on the previous sample.
+    const auto feedbackScale = static_cast<SampleType> (0.5);
+    const auto* feedbackRamp = feedbackValues;
+    const auto settledFeedback = feedback.getCurrentValue();
+    const auto saturating = saturator.isActive();
+    auto last = lastOutput;
+    auto mirrored = mirroredFrames;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const Frame input { { inputLeft[i], inputRight[i] } };
+        const Frame wet { { wetLeft[(size_t) i], wetRight[(size_t) i] } };
+
+        const auto toDelay = input - last;
+        const auto output = wet + last;
+
+        if constexpr (variableDelay)
+        {
+            writeLeft[(size_t) i]  += toDelay[0];
+            writeRight[(size_t) i] += toDelay[1];
+        }
+        else
+        {
+            writeLeft[(size_t) i]  = toDelay[0];
+            writeRight[(size_t) i] = toDelay[1];
+        }
+
+        mirrored = writeLeft[(size_t) i] == writeRight[(size_t) i] ? mirrored + 1 : 0;
+
+        outputLeft[i]  = output[0];
+        outputRight[i] = output[1];
+
+        last = output * ((feedbackRamp != nullptr ? feedbackRamp[i] : settledFeedback) * feedbackScale);
+
+        if (saturating)
+            last = saturator.process (last);
+    }
+
+    if (feedbackValues != nullptr)
+        feedbackValues += numSamples;
+
+    lastOutput = last;
+    mirroredFrames = juce::jmin (mirrored, delayBuffer.getMaxDelayInSamples());
+
+    delayBuffer.writeBlock (writeLeft.data(), writeRight.data(), numSamples);
+
+    taps.template process<type, mode> (delayBuffer, outputLeft, outputRight, numSamples);
+}
+
+template <typename SampleType>
+template <juce::dsp::StateVariableTPTFilterType type, DelayInterpolation mode, bool variableDelay>
+void DelayEngine<SampleType>::processMonoChunk (const SampleType* input, SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept
+{
+    jassert (numSamples <= maxChunkSize);
+
+    if constexpr (variableDelay)
+    {
+        // Both ramps hold the same values; the right one just keeps pace.
+        for (int i = 0; i < numSamples; ++i)
+            variableDelayLeft[(size_t) i] = getNextVariableDelays()[0];
+
+        delayBuffer.template readBlock<mode> (0, variableDelayLeft.data(), wetLeft.data(), numSamples, allpassState[0]);
+    }
+    else
+    {
+        delayBuffer.template readBlock<mode> (0, delayLeft.getCurrentValue(), wetLeft.data(), numSamples, allpassState[0]);
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+        wetLeft[(size_t) i] = filter.template processLeftLane<type> (wetLeft[(size_t) i]);
+
+    const auto feedbackScale = static_cast<SampleType> (0.5);
+    const auto* feedbackRamp = feedbackValues;
+    const auto settledFeedback = feedback.getCurrentValue();
+    const auto saturating = saturator.isActive();
+    auto last = lastOutput[0];
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto toDelay = input[i] - last;
+        const auto output = wetLeft[(size_t) i] + last;
+
+        writeLeft[(size_t) i] = toDelay;
+        outputLeft[i] = output;
+
+        last = output * ((feedbackRamp != nullptr ? feedbackRamp[i] : settledFeedback) * feedbackScale);
+
+        if (saturating)
+            last = saturator.processLeftLane (last);
+    }
+
+    if (feedbackValues != nullptr)
+        feedbackValues += numSamples;
+
+    lastOutput[0] = last;
+    rightLaneStale = true;
+    mirroredFrames = juce::jmin (mirroredFrames + numSamples, delayBuffer.getMaxDelayInSamples());
+
+    // Both lanes of the ring are still written, for the taps and for when
+    // the lanes part again.
+    delayBuffer.writeBlock (writeLeft.data(), writeLeft.data(), numSamples);
+    std::copy (outputLeft, outputLeft + numSamples, outputRight);
+
+    taps.template process<type, mode> (delayBuffer, outputLeft, outputRight, numSamples);
+}
+
+template <typename SampleType>
+template <juce::dsp::StateVariableTPTFilterType type>
+void DelayEngine<SampleType>::filterChunk (int numSamples) noexcept
+{
+    if (oversampler == nullptr)
+    {
+        filterSamples<type> (wetLeft.data(), wetRight.data(), (size_t) numSamples);
+        return;
+    }
+
+    SampleType* channels[] { wetLeft.data(), wetRight.data() };
+    juce::dsp::AudioBlock<SampleType> block (channels, 2, (size_t) numSamples);
+
+    auto upsampled = oversampler->processSamplesUp (block);
+    filterSamples<type> (upsampled.getChannelPointer (0), upsampled.getChannelPointer (1), upsampled.getNumSamples());
+
+    oversampler->processSamplesDown (block);
+}
+
+template <typename SampleType>
+template <juce::dsp::StateVariableTPTFilterType type>
+void DelayEngine<SampleType>::filterSamples (SampleType* left, SampleType* right, size_t numSamples) noexcept
+{
+    // The glide check stays out of the loop that runs when nothing is modulated.
+    if (filter.isGliding())
+    {
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const auto wet = filter.template processFrameGliding<type> ({ { left[i], right[i] } });
+            left[i]  = wet[0];
+            right[i] = wet[1];
+        }
+
+        return;
+    }
+
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        const auto wet = filter.template processFrame<type> ({ { left[i], right[i] } });
+        left[i]  = wet[0];
+        right[i] = wet[1];
+    }
+}
+
+//==============================================================================
+template <typename SampleType>
+void DelayEngine<SampleType>::processCrossfade (const SampleType* inputLeft, const SampleType* inputRight,
+                                                SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept
+{
+    using Mode = DelayInterpolation;
+
+    switch (interpolation)
+    {
+        case Mode::linear:        processCrossfade<Mode::linear>       (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        case Mode::lagrange3rd:   processCrossfade<Mode::lagrange3rd>  (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        case Mode::thiran:        processCrossfade<Mode::thiran>       (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        case Mode::windowedSinc:  processCrossfade<Mode::windowedSinc> (inputLeft, inputRight, outputLeft, outputRight, numSamples); break;
+        default:                  jassertfalse; break;
+    }
+}
+
+template <typename SampleType>
+template <DelayInterpolation mode>
+void DelayEngine<SampleType>::processCrossfade (const SampleType* inputLeft, const SampleType* inputRight,
+                                                SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept
+{
+    const auto feedbackScale = static_cast<SampleType> (0.5);
+    const auto* feedbackRamp = feedbackValues;
+    const auto settledFeedback = feedback.getCurrentValue();
+    const auto saturating = saturator.isActive();
+    const auto minDelay = static_cast<SampleType> (getInterpolationLookahead (mode));
+    const auto step = static_cast<SampleType> (1) / static_cast<SampleType> (crossfadeLengthInSamples);
+    const auto firstStep = crossfadeLengthInSamples - crossfadeSamplesLeft + 1;
+    auto last = lastOutput;
+    auto tap = lastModulatedTap;
+    auto mirrored = mirroredFrames;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const Frame input { { inputLeft[i], inputRight[i] } };
+        auto toDelay = input - last;
+
+        // Both heads follow the same modulation; only their base delays differ.
+        const Frame delays { { delayLeftValues  != nullptr ? *delayLeftValues++  : delayLeft.getCurrentValue(),
+                               delayRightValues != nullptr ? *delayRightValues++ : delayRight.getCurrentValue() } };
+        auto offsets = Frame::fromScalar (-readOffset);
+
+        if (controlDelayMoving)
+        {
+            controlDelayOffset = controlDelayOffset + controlDelayStep;
+            offsets = offsets + controlDelayOffset;
+        }
+
+        if (modulationEnabled)
+        {
+            offsets = offsets + getNextModulationOffsets();
+            toDelay = toDelay + tap * modulationFeedback;
+        }
+
+        const auto newDelays = delays + offsets;
+        const auto oldDelays = crossfadeFromDelay + offsets;
+
+        delayBuffer.advance();
+        delayBuffer.writeFrame (toDelay);
+        mirrored = toDelay[0] == toDelay[1] ? mirrored + 1 : 0;
+
+        const auto newRead = delayBuffer.template readFrame<mode> (juce::jmax (minDelay, newDelays[0]), juce::jmax (minDelay, newDelays[1]), allpassState);
+        const auto oldRead = delayBuffer.template readFrame<mode> (juce::jmax (minDelay, oldDelays[0]), juce::jmax (minDelay, oldDelays[1]), crossfadeAllpassState);
+
+        const auto position = static_cast<SampleType> (firstStep + i) * step;
+        const auto delayed = oldRead + (newRead - oldRead) * position;
+
+        if (modulationEnabled)
+            tap = delayed;
+
+        const auto output = filterFrameCrossfade (delayed, position) + last;
+
+        outputLeft[i]  = output[0];
+        outputRight[i] = output[1];
+
+        processTaps<mode> (outputLeft + i, outputRight + i, 1);
+
+        last = output * ((feedbackRamp != nullptr ? feedbackRamp[i] : settledFeedback) * feedbackScale);
+
+        if (saturating)
+            last = saturator.process (last);
+    }
+
+    if (feedbackValues != nullptr)
+        feedbackValues += numSamples;
+
+    lastOutput = last;
+    lastModulatedTap = tap;
+    mirroredFrames = juce::jmin (mirrored, delayBuffer.getMaxDelayInSamples());
+}
+
+template <typename SampleType>
+typename DelayEngine<SampleType>::Frame DelayEngine<SampleType>::filterFrameCrossfade (Frame input, SampleType position) noexcept
+{
+    const auto toType = filter.getType();
+
+    if (oversampler == nullptr)
+        return filter.processFrameCrossfade (input, crossfadeFromType, toType, position);
+
+    wetLeft[0]  = input[0];
+    wetRight[0] = input[1];
+
+    SampleType* channels[] { wetLeft.data(), wetRight.data() };
+    juce::dsp::AudioBlock<SampleType> block (channels, 2, 1);
+
+    auto upsampled = oversampler->processSamplesUp (block);
+    auto* left  = upsampled.getChannelPointer (0);
+    auto* right = upsampled.getChannelPointer (1);
+
+    for (size_t i = 0; i < upsampled.getNumSamples(); ++i)
+    {
+        const auto wet = filter.processFrameCrossfade ({ { left[i], right[i] } }, crossfadeFromType, toType, position);
+        left[i]  = wet[0];
+        right[i] = wet[1];
+    }
+
+    oversampler->processSamplesDown (block);
+
+    return { { wetLeft[0], wetRight[0] } };
+}
+
+template <typename SampleType>
+template <DelayInterpolation mode>
+void DelayEngine<SampleType>::processTaps (SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept
+{
+    switch (filter.getType())
+    {
+        case FilterType::lowpass:   taps.template process<FilterType::lowpass,  mode> (delayBuffer, outputLeft, outputRight, numSamples); break;
+        case FilterType::highpass:  taps.template process<FilterType::highpass, mode> (delayBuffer, outputLeft, outputRight, numSamples); break;
+        case FilterType::bandpass:  taps.template process<FilterType::bandpass, mode> (delayBuffer, outputLeft, outputRight, numSamples); break;
+        default:                    jassertfalse; break;
+    }
+}
+
+//==============================================================================
+template class DelayEngine<float>;
+template class DelayEngine<double>;
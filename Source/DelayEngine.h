@@ -0,0 +1,293 @@
+/*
+  ==============================================================================
+
+    DelayEngine.h
+
+    The delay, filter and feedback loop at the heart of the plugin.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayTaps.h"
+#include "FeedbackSaturator.h"
+#include "ParameterRamp.h"
+#include "StereoDelayBuffer.h"
+#include "StereoSVF.h"
+
+//==============================================================================
+/**
+    Control-rate modulation for one call to DelayEngine::process().
+
+    The block is cut into intervals of intervalLength samples from its start
+    (the last one may be shorter), and each array holds one value per
+    interval: where that setting should have arrived by the interval's end.
+*/
+struct ControlModulation
+{
+    int intervalLength = 32;
+    int numIntervals = 0;
+
+    const float* cutoffHz = nullptr;
+    const float* resonance = nullptr;
+    const float* delayOffsetLeft = nullptr;     // in samples, added to the set delays
+    const float* delayOffsetRight = nullptr;
+};
+
+//==============================================================================
+/**
+    Runs the feedback delay loop for both channels in one fused pass: each
+    frame is written, read back, filtered and fed back as a StereoFrame.
+
+    Filter oversampling, output taps, feedback saturation, modulation and
+    long delays are optional. Delay and feedback changes glide, and
+    startCrossfade() crossfades to a whole new set of settings.
+*/
+template <typename SampleType>
+class DelayEngine
+{
+public:
+    using FilterType = juce::dsp::StateVariableTPTFilterType;
+    using Frame      = StereoFrame<SampleType>;
+
+    //==============================================================================
+    void prepare (const juce::dsp::ProcessSpec& spec, double maxDelayMs);
+    void reset();
+
+    //==============================================================================
+    void setFilterType (FilterType newType) noexcept          { filter.setType (newType); }
+    void setCutoffFrequency (SampleType newCutoffHz);
+    void setResonance (SampleType newResonance);
+    void setFeedback (SampleType newFeedback) noexcept        { feedback.setTargetValue (newFeedback); }
+    void setInterpolation (DelayInterpolation newInterpolation) noexcept;
+
+    /** Soft-limits the signal fed back round the loop; see FeedbackSaturator.
+        The drive is a linear gain.
+    */
+    void setSaturation (SaturationShape newShape, SampleType newDrive) noexcept;
+
+    /** Builds the half-band filters for one oversampling variant, once. This
+        allocates, so call it off the audio thread.
+    */
+    void allocateOversampling (int order, bool useLinearPhase);
+
+    /** Runs the loop filter at 2^order times the sample rate (order 0 turns
+        oversampling off), with linear-phase FIR or polyphase IIR half-band
+        filters. Returns false and changes nothing if allocateOversampling()
+        hasn't built that variant yet.
+    */
+    bool setOversampling (int newOrder, bool useLinearPhase) noexcept;
+
+    void setModulationEnabled (bool shouldBeEnabled) noexcept;
+    void setModulationRate (SampleType newRateHz) noexcept;
+    /** Depth from 0 to 1, scaled to maxModulationDepthMs. */
+    void setModulationDepth (SampleType newDepth) noexcept;
+    void setModulationFeedback (SampleType newFeedback) noexcept  { modulationFeedback = newFeedback; }
+
+    /** Sets the per-channel delay in samples; values are clamped to the buffer size.
+        The read heads glide to the new delays over delayRampSeconds.
+    */
+    void setDelay (SampleType newDelayLeft, SampleType newDelayRight) noexcept;
+
+    /** Crossfades to the settings made from now until the next process() call,
+        instead of gliding to them, over crossfadeSeconds.
+    */
+    void startCrossfade() noexcept;
+
+    /** Sets the modulation for the next process() call only; it must stay
+        valid until then. While it's set, the cutoff and resonance it holds
+        replace the ones set directly, so call setCutoffFrequency() and
+        setResonance() again once it stops.
+    */
+    void setControlModulation (const ControlModulation* newControl) noexcept  { control = newControl; }
+
+    int getMaxDelayInSamples() const noexcept                 { return maxDelayInSamples; }
+
+    /** Allocates the compact history for delays up to maxDelayMs. This
+        allocates, so call it off the audio thread, and only while the long
+        delay is switched off.
+    */
+    void allocateLongDelay (double maxDelayMs);
+    void releaseLongDelay()                                   { delayBuffer.releaseLongRange(); }
+
+    /** Switches the long delay range in or out once it's allocated; safe on the
+        audio thread. Switching it out pulls every delay still beyond the
+        standard range back inside it at once.
+    */
+    void setLongDelayEnabled (bool shouldBeEnabled) noexcept;
+
+    /** The delay memory held, in bytes. */
+    size_t getMemoryUsageInBytes() const noexcept             { return delayBuffer.getMemoryUsageInBytes(); }
+
+    /** Output-only taps on the same delay memory; see DelayTaps. */
+    void setNumTaps (int newNumTaps) noexcept                 { taps.setNumTaps (newNumTaps); }
+    void setTap (int index, SampleType delayInSamples, SampleType gain, SampleType pan) noexcept;
+
+    /** The furthest the read head swings either side of the set delay. */
+    static constexpr double maxModulationDepthMs = 10.0;
+
+    static constexpr int maxOversamplingOrder = 2;
+
+    static constexpr double delayRampSeconds = 0.25;
+    static constexpr double feedbackRampSeconds = 0.05;
+    static constexpr double crossfadeSeconds = 0.05;
+
+    //==============================================================================
+    /** Replaces the first one or two channels of the context with the wet signal. */
+    void process (const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept;
+
+private:
+    //==============================================================================
+    void processFrames (const SampleType* inputLeft, const SampleType* inputRight,
+                        SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept;
+
+    template <FilterType type>
+    void processFrames (const SampleType* inputLeft, const SampleType* inputRight,
+                        SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept;
+
+    template <FilterType type, DelayInterpolation interpolation>
+    void processFrames (const SampleType* inputLeft, const SampleType* inputRight,
+                        SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept;
+
+    template <FilterType type, DelayInterpolation interpolation, bool variableDelay>
+    void processFrames (const SampleType* inputLeft, const SampleType* inputRight,
+                        SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept;
+
+    /** One chunk whose reads all land on frames written before it. A
+        variable delay chunk takes its delays from the ramps, or from
+        delaysLeft and delaysRight when they have already been worked out.
+    */
+    template <FilterType type, DelayInterpolation interpolation, bool variableDelay>
+    void processChunk (const SampleType* inputLeft, const SampleType* inputRight,
+                       SampleType* outputLeft, SampleType* outputRight, int numSamples,
+                       const SampleType* delaysLeft = nullptr, const SampleType* delaysRight = nullptr) noexcept;
+
+    /** Writes and reads one frame at a time, for delays too short to chunk.
+        Takes delays as processChunk() does.
+    */
+    template <FilterType type, DelayInterpolation interpolation, bool variableDelay>
+    void processFrameByFrame (const SampleType* inputLeft, const SampleType* inputRight,
+                              SampleType* outputLeft, SampleType* outputRight, int numSamples,
+                              const SampleType* delaysLeft = nullptr, const SampleType* delaysRight = nullptr) noexcept;
+
+    /** The oversampled fallback: works the delays out ahead and runs the
+        frames in the longest chunks their actual delays allow, since every
+        pass through the oversampler costs far more than a frame does.
+    */
+    template <FilterType type, DelayInterpolation interpolation>
+    void processShortRuns (const SampleType* inputLeft, const SampleType* inputRight,
+                           SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept;
+
+    /** processChunk() for the left lane alone, copied to outputRight. */
+    template <FilterType type, DelayInterpolation interpolation, bool variableDelay>
+    void processMonoChunk (const SampleType* input, SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept;
+
+    /** Whether both lanes of this block compute the same thing, so only the left one needs to run. */
+    bool canProcessAsMono (const SampleType* inputLeft, const SampleType* inputRight, int numSamples) const noexcept;
+
+    /** Brings the right lane's state back in line after mono processing. */
+    void syncRightLane() noexcept;
+
+    /** The per-frame loop with two read heads, while a crossfade runs. */
+    void processCrossfade (const SampleType* inputLeft, const SampleType* inputRight,
+                           SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept;
+
+    template <DelayInterpolation interpolation>
+    void processCrossfade (const SampleType* inputLeft, const SampleType* inputRight,
+                           SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept;
+
+    Frame filterFrameCrossfade (Frame input, SampleType position) noexcept;
+
+    template <DelayInterpolation interpolation>
+    void processTaps (SampleType* outputLeft, SampleType* outputRight, int numSamples) noexcept;
+
+    template <FilterType type>
+    void filterChunk (int numSamples) noexcept;
+
+    template <FilterType type>
+    void filterSamples (SampleType* left, SampleType* right, size_t numSamples) noexcept;
+
+    /** Starts the filter and delay offset glides for one control interval. */
+    void applyControlInterval (int interval, int numSamples) noexcept;
+
+    void updateOversampling() noexcept;
+
+    static size_t getOversamplerIndex (int order, bool useLinearPhase) noexcept  { return (size_t) ((order - 1) * 2 + (useLinearPhase ? 1 : 0)); }
+
+    /** Advances the LFO and returns the read head offsets for both channels. */
+    Frame getNextModulationOffsets() noexcept;
+
+    /** The next frame's delays from the delay ramps plus any modulation. */
+    Frame getNextVariableDelays() noexcept;
+
+    SampleType getModulationDepthInSamples() const noexcept;
+
+    //==============================================================================
+    static constexpr int maxChunkSize = 64;
+    static constexpr int minChunkSize = 8;
+
+    //==============================================================================
+    juce::SharedResourcePointer<WindowedSincTable<SampleType>> sincTable;
+    StereoDelayBuffer<SampleType> delayBuffer;
+    StereoSVF<SampleType> filter;
+    FeedbackSaturator<SampleType> saturator;
+    DelayTaps<SampleType> taps;
+    ParameterRamp<SampleType> feedback, delayLeft, delayRight;
+
+    using Oversampler = juce::dsp::Oversampling<SampleType>;
+    std::array<std::unique_ptr<Oversampler>, (size_t) (maxOversamplingOrder * 2)> oversamplers;
+    std::array<std::atomic<bool>, (size_t) (maxOversamplingOrder * 2)> oversamplerReady {};
+    Oversampler* oversampler = nullptr;
+    int oversamplingOrder = 0;
+    bool oversamplingLinearPhase = false;
+    SampleType readOffset = 0;
+
+    DelayInterpolation interpolation = DelayInterpolation::linear;
+    Frame allpassState {};
+    Frame lastOutput {};
+    int maxDelayInSamples = 0;
+    int delayHeadroomInSamples = 0;     // kept free at the end of the ring for modulation and taps
+
+    // The old read heads and filter type while a crossfade runs.
+    bool crossfadeStarting = false;
+    int crossfadeLengthInSamples = 0, crossfadeSamplesLeft = 0;
+    Frame crossfadeFromDelay {};
+    Frame crossfadeAllpassState {};
+    FilterType crossfadeFromType = FilterType::lowpass;
+    SampleType crossfadeCutoff = 0, crossfadeResonance = 0;
+    bool crossfadeFilterChanged = false;
+
+    // How many of the most recently written frames have identical lanes,
+    // capped at the ring size.
+    int mirroredFrames = 0;
+    bool processMono = false, rightLaneStale = false;
+    int maximumBlockSize = 0;
+
+    // Per-block ramp values, or nullptr while a parameter is settled.
+    const SampleType* feedbackValues = nullptr;
+    const SampleType* delayLeftValues = nullptr;
+    const SampleType* delayRightValues = nullptr;
+    SampleType shortestDelayInBlock = 0;
+
+    double sampleRate = 44100.0;
+    bool modulationRequested = false, modulationEnabled = false;
+    SampleType modulationRateHz = 1;
+    SampleType modulationDepth = 0;
+    SampleType modulationFeedback = 0;
+    juce::LinearSmoothedValue<SampleType> modulationDepthInSamples;
+    SampleType lfoSin = 0, lfoCos = 1;
+    SampleType lfoRotationSin = 0, lfoRotationCos = 1;
+    Frame lastModulatedTap {};
+
+    const ControlModulation* control = nullptr;
+    Frame controlDelayOffset {}, controlDelayTarget {}, controlDelayStep {};
+    bool controlDelayMoving = false;
+
+    std::vector<SampleType> monoScratch;
+
+    std::array<SampleType, maxChunkSize> wetLeft {}, wetRight {};
+    std::array<SampleType, maxChunkSize> writeLeft {}, writeRight {};
+    std::array<SampleType, maxChunkSize> variableDelayLeft {}, variableDelayRight {};
+};
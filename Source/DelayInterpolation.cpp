@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    DelayInterpolation.cpp
+
+    Read-head interpolation modes and the shared windowed-sinc table.
+
+  ==============================================================================
+*/
+
+#include "DelayInterpolation.h"
+
+//==============================================================================
+template <typename SampleType>
+WindowedSincTable<SampleType>::WindowedSincTable()
+    : coefficients ((size_t) ((numPhases + 1) * numTaps))
+{
+    constexpr auto pi = juce::MathConstants<double>::pi;
+    constexpr auto halfWidth = numTaps / 2;
+
+    // One extra phase, so the reader can interpolate towards phase + 1 at the end.
+    for (int phase = 0; phase <= numPhases; ++phase)
+    {
+        const auto fraction = (double) phase / numPhases;
+        auto* row = coefficients.data() + phase * numTaps;
+        double sum = 0.0;
+
+        std::array<double, numTaps> taps;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            const auto x = fraction + (halfWidth - 1) - tap;
+            const auto sinc = std::abs (x) < 1.0e-9 ? 1.0 : std::sin (pi * x) / (pi * x);
+            const auto window = std::abs (x) >= halfWidth ? 0.0
+                                                          : 0.42 + 0.5 * std::cos (pi * x / halfWidth)
+                                                                 + 0.08 * std::cos (2.0 * pi * x / halfWidth);
+            taps[(size_t) tap] = sinc * window;
+            sum += taps[(size_t) tap];
+        }
+
+        // Unity gain at DC for every phase.
+        for (int tap = 0; tap < numTaps; ++tap)
+            row[tap] = static_cast<SampleType> (taps[(size_t) tap] / sum);
+    }
+}
+
+//==============================================================================
+template class WindowedSincTable<float>;
+template class WindowedSincTable<double>;
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    DelayInterpolation.h
+
+    Read-head interpolation modes and the shared windowed-sinc table.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** How fractional delays are read, from cheapest to cleanest. */
+enum class DelayInterpolation
+{
+    linear,
+    lagrange3rd,
+    thiran,
+    windowedSinc
+};
+
+/** How many frames newer than the integer delay a read touches. */
+constexpr int getInterpolationLookahead (DelayInterpolation mode) noexcept
+{
+    return mode == DelayInterpolation::windowedSinc ? 3
+         : mode == DelayInterpolation::linear       ? 0
+                                                    : 1;
+}
+
+/** How many frames older than the integer delay a read touches. */
+constexpr int getInterpolationLookbehind (DelayInterpolation mode) noexcept
+{
+    return mode == DelayInterpolation::windowedSinc ? 4
+         : mode == DelayInterpolation::lagrange3rd  ? 2
+                                                    : 1;
+}
+
+//==============================================================================
+/**
+    Polyphase coefficients for an 8-tap Blackman-windowed sinc.
+
+    The table is the same for every instance, so it is held through a
+    juce::SharedResourcePointer and only built by the first one.
+*/
+template <typename SampleType>
+class WindowedSincTable
+{
+public:
+    static constexpr int numTaps = 8;
+    static constexpr int numPhases = 512;
+
+    WindowedSincTable();
+
+    /** Coefficients for phase 0...numPhases; tap t weights the sample at delay (int) + t - 3. */
+    const SampleType* getCoefficients (int phase) const noexcept    { return coefficients.data() + phase * numTaps; }
+
+private:
+    std::vector<SampleType> coefficients;
+
+    JUCE_DECLARE_NON_COPYABLE (WindowedSincTable)
+};
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    DelayTaps.cpp
+
+    Extra read taps on the shared delay memory.
+
+  ==============================================================================
+*/
+
+#include "DelayTaps.h"
+
+//==============================================================================
+template <typename SampleType>
+void DelayTaps<SampleType>::prepare (double newSampleRate)
+{
+    jassert (newSampleRate > 0.0);
+
+    sampleRate = newSampleRate;
+
+    // One-pole glide of roughly 50 ms for tap times and gains.
+    smoothing = static_cast<SampleType> (1.0 - std::exp (-1.0 / (0.05 * sampleRate)));
+
+    updateCoefficients();
+    reset();
+}
+
+template <typename SampleType>
+void DelayTaps<SampleType>::reset() noexcept
+{
+    delays = targetDelays;
+    gainsLeft = targetGainsLeft;
+    gainsRight = targetGainsRight;
+    s1 = {};
+    s2 = {};
+    allpassLeft = {};
+    allpassRight = {};
+}
+
+template <typename SampleType>
+void DelayTaps<SampleType>::setNumTaps (int newNumTaps) noexcept
+{
+    newNumTaps = juce::jlimit (0, maxTaps, newNumTaps);
+
+    // Taps coming in start from silence at their target time.
+    for (auto tap = (size_t) numTaps; tap < (size_t) newNumTaps; ++tap)
+    {
+        delays[tap] = targetDelays[tap];
+        gainsLeft[tap] = gainsRight[tap] = 0;
+        s1[tap] = s2[tap] = 0;
+        allpassLeft[tap] = allpassRight[tap] = 0;
+    }
+
+    numTaps = newNumTaps;
+}
+
+template <typename SampleType>
+void DelayTaps<SampleType>::setTap (int index, SampleType delayInSamples, SampleType gain, SampleType pan) noexcept
+{
+    jassert (juce::isPositiveAndBelow (index, maxTaps));
+
+    // Constant-power pan law.
+    const auto angle = (juce::jlimit (static_cast<SampleType> (-1), static_cast<SampleType> (1), pan) + 1)
+                     * juce::MathConstants<SampleType>::pi / 4;
+
+    const auto tap = (size_t) index;
+    targetDelays[tap] = delayInSamples;
+    targetGainsLeft[tap]  = gain * std::cos (angle);
+    targetGainsRight[tap] = gain * std::sin (angle);
+}
+
+template <typename SampleType>
+void DelayTaps<SampleType>::limitDelays (SampleType maxDelayInSamples) noexcept
+{
+    for (size_t tap = 0; tap < (size_t) maxTaps; ++tap)
+    {
+        delays[tap] = juce::jmin (delays[tap], maxDelayInSamples);
+        targetDelays[tap] = juce::jmin (targetDelays[tap], maxDelayInSamples);
+    }
+}
+
+template <typename SampleType>
+void DelayTaps<SampleType>::setCutoffFrequency (SampleType newCutoffHz) noexcept
+{
+    cutoffFrequency = newCutoffHz;
+    updateCoefficients();
+}
+
+template <typename SampleType>
+void DelayTaps<SampleType>::setResonance (SampleType newResonance) noexcept
+{
+    resonance = juce::jmax (static_cast<SampleType> (0.05), newResonance);
+    updateCoefficients();
+}
+
+template <typename SampleType>
+void DelayTaps<SampleType>::setFilter (SampleType newCutoffHz, SampleType newResonance) noexcept
+{
+    cutoffFrequency = newCutoffHz;
+    resonance = juce::jmax (static_cast<SampleType> (0.05), newResonance);
+    updateCoefficients();
+}
+
+template <typename SampleType>
+void DelayTaps<SampleType>::updateCoefficients() noexcept
+{
+    coefficients = StereoSVF<SampleType>::makeCoefficients (cutoffFrequency, resonance, sampleRate);
+}
+
+template <typename SampleType>
+void DelayTaps<SampleType>::snapToZero() noexcept
+{
+    for (size_t tap = 0; tap < (size_t) numTaps; ++tap)
+    {
+        juce::dsp::util::snapToZero (s1[tap]);
+        juce::dsp::util::snapToZero (s2[tap]);
+    }
+}
+
+//==============================================================================
+template class DelayTaps<float>;
+template class DelayTaps<double>;
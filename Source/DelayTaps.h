@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    DelayTaps.h
+
+    Extra read taps on the shared delay memory.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StereoDelayBuffer.h"
+#include "StereoSVF.h"
+
+//==============================================================================
+/**
+    Up to maxTaps additional read positions on a StereoDelayBuffer, each with
+    its own delay, gain, pan and filter state.
+
+    Taps only add to the wet output and never feed back. Each one reads the
+    mid signal at its delay, runs it through its own copy of the loop filter
+    and pans it into the stereo field.
+
+    Everything per tap is stored as a structure of arrays, so every stage
+    apart from the reads themselves is a plain loop across taps with no
+    dependencies between iterations.
+*/
+template <typename SampleType>
+class DelayTaps
+{
+public:
+    static constexpr int maxTaps = 16;
+
+    using FilterType = juce::dsp::StateVariableTPTFilterType;
+
+    //==============================================================================
+    void prepare (double sampleRate);
+    void reset() noexcept;
+
+    void setNumTaps (int newNumTaps) noexcept;
+    int getNumTaps() const noexcept                               { return numTaps; }
+
+    /** Sets one tap's delay in samples, linear gain and pan from -1 (left) to 1 (right).
+        Delay and gain changes glide rather than jump.
+    */
+    void setTap (int index, SampleType delayInSamples, SampleType gain, SampleType pan) noexcept;
+
+    /** Cuts every tap's delay, gliding or not, down to at most maxDelayInSamples at once. */
+    void limitDelays (SampleType maxDelayInSamples) noexcept;
+
+    void setCutoffFrequency (SampleType newCutoffHz) noexcept;
+    void setResonance (SampleType newResonance) noexcept;
+
+    /** Sets cutoff and resonance together, working the coefficients out once. */
+    void setFilter (SampleType newCutoffHz, SampleType newResonance) noexcept;
+
+    //==============================================================================
+    /** Adds every tap for the numFrames frames most recently written to the
+        buffer into the outputs. Call after those frames have been written.
+    */
+    template <FilterType type, DelayInterpolation mode>
+    void process (const StereoDelayBuffer<SampleType>& buffer, SampleType* outputLeft, SampleType* outputRight, int numFrames) noexcept
+    {
+        const auto count = (size_t) numTaps;
+
+        if (count == 0)
+            return;
+
+        const auto g = coefficients.g, R2 = coefficients.R2, h = coefficients.h;
+        const auto half = static_cast<SampleType> (0.5);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            // Frame i was written (numFrames - 1 - i) frames before the newest one.
+            const auto age = static_cast<SampleType> (numFrames - 1 - i);
+
+            for (size_t tap = 0; tap < count; ++tap)
+            {
+                delays[tap]     += (targetDelays[tap]     - delays[tap])     * smoothing;
+                gainsLeft[tap]  += (targetGainsLeft[tap]  - gainsLeft[tap])  * smoothing;
+                gainsRight[tap] += (targetGainsRight[tap] - gainsRight[tap]) * smoothing;
+            }
+
+            for (size_t tap = 0; tap < count; ++tap)
+                tapInput[tap] = half * (buffer.template read<mode> (0, delays[tap] + age, allpassLeft[tap])
+                                      + buffer.template read<mode> (1, delays[tap] + age, allpassRight[tap]));
+
+            // The loop filter, once per tap.
+            for (size_t tap = 0; tap < count; ++tap)
+            {
+                const auto yHP = (tapInput[tap] - s1[tap] * (g + R2) - s2[tap]) * h;
+
+                const auto yBP = yHP * g + s1[tap];
+                s1[tap] = yHP * g + yBP;
+
+                const auto yLP = yBP * g + s2[tap];
+                s2[tap] = yBP * g + yLP;
+
+                if constexpr (type == FilterType::lowpass)        tapInput[tap] = yLP;
+                else if constexpr (type == FilterType::highpass)  tapInput[tap] = yHP;
+                else                                              tapInput[tap] = yBP;
+            }
+
+            SampleType left = 0, right = 0;
+
+            for (size_t tap = 0; tap < count; ++tap)
+            {
+                left  += tapInput[tap] * gainsLeft[tap];
+                right += tapInput[tap] * gainsRight[tap];
+            }
+
+            outputLeft[i]  += left;
+            outputRight[i] += right;
+        }
+    }
+
+    /** Flushes denormal filter state; call once per block. */
+    void snapToZero() noexcept;
+
+private:
+    //==============================================================================
+    void updateCoefficients() noexcept;
+
+    using Lanes = std::array<SampleType, (size_t) maxTaps>;
+
+    int numTaps = 0;
+    double sampleRate = 44100.0;
+    SampleType cutoffFrequency = 1000, resonance = static_cast<SampleType> (1.0 / juce::MathConstants<double>::sqrt2);
+    typename StereoSVF<SampleType>::Coefficients coefficients;
+    SampleType smoothing = 1;
+
+    alignas (32) Lanes delays {}, targetDelays {};
+    alignas (32) Lanes gainsLeft {}, gainsRight {}, targetGainsLeft {}, targetGainsRight {};
+    alignas (32) Lanes s1 {}, s2 {};
+    alignas (32) Lanes allpassLeft {}, allpassRight {};
+    alignas (32) Lanes tapInput {};
+};
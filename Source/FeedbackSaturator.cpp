@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    FeedbackSaturator.cpp
+
+    Antialiased soft limiting for the signal fed back round the delay loop.
+
+  ==============================================================================
+*/
+
+#include "FeedbackSaturator.h"
+
+namespace
+{
+//==============================================================================
+// Each shape and its antiderivative, for x >= 0; both are symmetric about 0.
+struct ShapeFunctions
+{
+    double (*value) (double);
+    double (*antiderivative) (double);
+};
+
+constexpr double softKnee = 1.5;
+const double ln2 = std::log (2.0);
+
+const ShapeFunctions shapeFunctions[]
+{
+    // tape: tanh, whose antiderivative log (cosh x) is written so it can't overflow.
+    { [] (double x) { return std::tanh (x); },
+      [] (double x) { return x + std::log1p (std::exp (-2.0 * x)) - ln2; } },
+
+    // soft: x - 4x^3/27 up to the knee, where it reaches 1 with zero slope.
+    { [] (double x) { return x < softKnee ? x - 4.0 * x * x * x / 27.0 : 1.0; },
+      [] (double x) { return x < softKnee ? x * x / 2.0 - x * x * x * x / 27.0
+                                          : x - softKnee + softKnee * softKnee / 2.0 - std::pow (softKnee, 4.0) / 27.0; } },
+
+    // hard
+    { [] (double x) { return juce::jmin (x, 1.0); },
+      [] (double x) { return x < 1.0 ? x * x / 2.0 : x - 0.5; } }
+};
+}
+
+//==============================================================================
+SaturationTables::SaturationTables()
+{
+    constexpr auto width = 1.0 / segmentsPerUnit;
+
+    for (size_t index = 0; index < segments.size(); ++index)
+    {
+        const auto& functions = shapeFunctions[index];
+
+        const auto value = [&] (double x)          { return x < 0.0 ? -functions.value (-x) : functions.value (x); };
+        const auto antiderivative = [&] (double x) { return functions.antiderivative (std::abs (x)); };
+
+        auto& shapeSegments = segments[index];
+        shapeSegments.resize ((size_t) numSegments);
+
+        for (int segment = 0; segment < numSegments; ++segment)
+        {
+            const auto x0 = (double) segment / segmentsPerUnit - inputRange;
+            const auto x1 = x0 + width;
+
+            const auto F0 = antiderivative (x0), F1 = antiderivative (x1);
+            const auto f0 = value (x0) * width, f1 = value (x1) * width;
+
+            shapeSegments[(size_t) segment] = { F0, f0, 3.0 * (F1 - F0) - 2.0 * f0 - f1, 2.0 * (F0 - F1) + f0 + f1 };
+        }
+
+        limits[index] = value (inputRange);
+        antiderivativesAtLimit[index] = antiderivative (inputRange);
+    }
+}
+
+//==============================================================================
+template <typename SampleType>
+void FeedbackSaturator<SampleType>::prepare (double sampleRate)
+{
+    drive.reset (sampleRate, driveRampSeconds);
+    reset();
+}
+
+template <typename SampleType>
+void FeedbackSaturator<SampleType>::reset() noexcept
+{
+    drive.setCurrentAndTargetValue (drive.getTargetValue());
+    previousInput = {};
+}
+
+template <typename SampleType>
+double FeedbackSaturator<SampleType>::getValue (double x) const noexcept
+{
+    const auto position = (x + SaturationTables::inputRange) * SaturationTables::segmentsPerUnit;
+
+    if (! isInRange (position))
+        return x < 0.0 ? -tables->getLimit (shape) : tables->getLimit (shape);
+
+    const auto segment = static_cast<int> (position);
+    const auto& s = tables->getSegments (shape)[segment];
+    const auto t = position - segment;
+
+    return (s.b + t * (2.0 * s.c + t * 3.0 * s.d)) * SaturationTables::segmentsPerUnit;
+}
+
+template <typename SampleType>
+double FeedbackSaturator<SampleType>::getAntiderivative (double x) const noexcept
+{
+    const auto position = (x + SaturationTables::inputRange) * SaturationTables::segmentsPerUnit;
+
+    // Beyond the table the shape is flat, so its antiderivative is a line.
+    if (! isInRange (position))
+        return tables->getAntiderivativeAtLimit (shape) + tables->getLimit (shape) * (std::abs (x) - SaturationTables::inputRange);
+
+    const auto segment = static_cast<int> (position);
+    const auto& s = tables->getSegments (shape)[segment];
+    const auto t = position - segment;
+
+    return s.a + t * (s.b + t * (s.c + t * s.d));
+}
+
+//==============================================================================
+template class FeedbackSaturator<float>;
+template class FeedbackSaturator<double>;
@@ -0,0 +1,189 @@
+/*
+  ==============================================================================
+
+    FeedbackSaturator.h
+
+    Antialiased soft limiting for the signal fed back round the delay loop.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StereoFrame.h"
+
+//==============================================================================
+/** The saturator's transfer functions. Each has unity gain at zero and
+    levels off at +/-1.
+*/
+enum class SaturationShape
+{
+    off,
+    tape,       // tanh
+    soft,       // cubic, flat from 1.5
+    hard        // clipped at 1
+};
+
+//==============================================================================
+/**
+    The antiderivative of every saturation shape, as one cubic per segment
+    of the input range.
+
+    Each cubic is the Hermite interpolation of the antiderivative from its
+    exact values and slopes at the segment's ends, so the curve and its
+    slope are continuous and the slope is the shape itself. The tables are
+    the same for every instance, so they are held through a
+    juce::SharedResourcePointer and only built by the first one.
+*/
+class SaturationTables
+{
+public:
+    /** a + b t + c t^2 + d t^3, for t from 0 to 1 across the segment. */
+    struct Segment
+    {
+        double a, b, c, d;
+    };
+
+    /** Past this every shape is taken as flat at its limit, so its
+        antiderivative is a straight line. tanh is the last to get there,
+        and is within 2.3e-7 of 1 by then.
+    */
+    static constexpr double inputRange = 8.0;
+    static constexpr int segmentsPerUnit = 256;
+    static constexpr int numSegments = 2 * (int) inputRange * segmentsPerUnit;
+
+    SaturationTables();
+
+    const Segment* getSegments (SaturationShape shape) const noexcept   { return segments[getIndex (shape)].data(); }
+
+    /** The shape's value and antiderivative at inputRange. */
+    double getLimit (SaturationShape shape) const noexcept               { return limits[getIndex (shape)]; }
+    double getAntiderivativeAtLimit (SaturationShape shape) const noexcept { return antiderivativesAtLimit[getIndex (shape)]; }
+
+private:
+    static constexpr int numShapes = 3;
+
+    static size_t getIndex (SaturationShape shape) noexcept
+    {
+        jassert (shape != SaturationShape::off);
+        return (size_t) shape - 1;
+    }
+
+    std::array<std::vector<Segment>, (size_t) numShapes> segments;
+    std::array<double, (size_t) numShapes> limits {}, antiderivativesAtLimit {};
+
+    JUCE_DECLARE_NON_COPYABLE (SaturationTables)
+};
+
+//==============================================================================
+/**
+    Soft-limits both lanes of the feedback signal, with first-order
+    antiderivative antialiasing (ADAA).
+
+    Each output is the mean of the shape between the last input and this
+    one, i.e. the difference of the antiderivative over the difference of
+    the inputs. Within a single table segment that quotient is worked out
+    from the cubic's coefficients directly, so it never loses precision
+    however close the inputs are. Everything runs in double, whatever the
+    sample type.
+
+    Drive scales the input up and the output back down by the same amount,
+    so quiet signals pass at unity gain and only loud ones are limited, to
+    1 / drive. Drive changes glide over driveRampSeconds.
+*/
+template <typename SampleType>
+class FeedbackSaturator
+{
+public:
+    using Frame = StereoFrame<SampleType>;
+
+    static constexpr double driveRampSeconds = 0.05;
+
+    //==============================================================================
+    void prepare (double sampleRate);
+    void reset() noexcept;
+
+    void setShape (SaturationShape newShape) noexcept         { shape = newShape; }
+    /** Linear gain, 1 or more. */
+    void setDrive (SampleType newDrive) noexcept              { drive.setTargetValue (juce::jmax (1.0, (double) newDrive)); }
+
+    bool isActive() const noexcept                            { return shape != SaturationShape::off; }
+
+    /** Takes input as the last sample seen, so that switching on doesn't
+        average against whatever came before it was switched off.
+    */
+    void startFrom (Frame input) noexcept                     { previousInput = { (double) input[0], (double) input[1] }; }
+
+    //==============================================================================
+    Frame process (Frame input) noexcept
+    {
+        const auto gain = drive.getNextValue();
+        return { { static_cast<SampleType> (processLane (input[0], previousInput[0], gain)),
+                   static_cast<SampleType> (processLane (input[1], previousInput[1], gain)) } };
+    }
+
+    SampleType processLeftLane (SampleType input) noexcept
+    {
+        return static_cast<SampleType> (processLane (input, previousInput[0], drive.getNextValue()));
+    }
+
+    /** True when both lanes hold the same state. */
+    bool lanesMatch() const noexcept                          { return previousInput[0] == previousInput[1]; }
+
+    /** Copies the left lane's state into the right lane. */
+    void mirrorLeftLane() noexcept                            { previousInput[1] = previousInput[0]; }
+
+private:
+    //==============================================================================
+    double processLane (double input, double& previous, double gain) noexcept
+    {
+        const auto output = getMeanValue (input * gain, previous * gain) / gain;
+        previous = input;
+        return output;
+    }
+
+    /** The shape's mean between x0 and x1. */
+    double getMeanValue (double x1, double x0) const noexcept
+    {
+        const auto position1 = (x1 + SaturationTables::inputRange) * SaturationTables::segmentsPerUnit;
+        const auto position0 = (x0 + SaturationTables::inputRange) * SaturationTables::segmentsPerUnit;
+
+        if (isInRange (position1) && isInRange (position0))
+        {
+            const auto segment1 = static_cast<int> (position1);
+
+            if (segment1 == static_cast<int> (position0))
+            {
+                const auto& s = tables->getSegments (shape)[segment1];
+                const auto t1 = position1 - segment1;
+                const auto t0 = position0 - segment1;
+
+                return (s.b + s.c * (t0 + t1) + s.d * (t0 * t0 + t0 * t1 + t1 * t1)) * SaturationTables::segmentsPerUnit;
+            }
+        }
+
+        const auto delta = x1 - x0;
+
+        // Across a segment boundary the inputs are never so close that the
+        // quotient matters, bar the odd one within rounding of it.
+        if (std::abs (delta) < 1.0e-7)
+            return getValue ((x0 + x1) * 0.5);
+
+        return (getAntiderivative (x1) - getAntiderivative (x0)) / delta;
+    }
+
+    double getValue (double x) const noexcept;
+    double getAntiderivative (double x) const noexcept;
+
+    static bool isInRange (double position) noexcept
+    {
+        return position >= 0.0 && position < (double) SaturationTables::numSegments;
+    }
+
+    //==============================================================================
+    juce::SharedResourcePointer<SaturationTables> tables;
+    SaturationShape shape = SaturationShape::off;
+    juce::LinearSmoothedValue<double> drive { 1.0 };
+    std::array<double, 2> previousInput {};
+};
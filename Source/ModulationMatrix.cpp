@@ -0,0 +1,194 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.cpp
+
+    LFOs and an input envelope follower routed to the delay's settings.
+
+  ==============================================================================
+*/
+
+#include "ModulationMatrix.h"
+
+//==============================================================================
+void ModulationMatrix::prepare (double newSampleRate, int maximumBlockSize)
+{
+    jassert (newSampleRate > 0.0);
+
+    sampleRate = newSampleRate;
+    amountStep = (float) (controlInterval / (amountGlideSeconds * sampleRate));
+
+    for (auto& destinationValues : values)
+        destinationValues.assign ((size_t) getNumIntervals (juce::jmax (1, maximumBlockSize)), 0.0f);
+
+    // Rates and times were set against the old sample rate.
+    for (auto& lfo : lfos)
+        lfo.phasePerSample = (float) (lfo.rateHz / sampleRate);
+
+    updateEnvelopeCoefficients();
+    reset();
+}
+
+void ModulationMatrix::reset() noexcept
+{
+    for (auto& lfo : lfos)
+    {
+        lfo.phase = 0.0f;
+        lfo.value = getLfoValue (lfo.shape, 0.0f);
+    }
+
+    // Nothing is playing, so there's nothing to fade.
+    for (auto& slot : slots)
+    {
+        slot.source = slot.targetSource;
+        slot.destination = slot.targetDestination;
+        slot.amount = slot.source != Source::off ? slot.targetAmount : 0.0f;
+    }
+
+    envelope = 0.0f;
+}
+
+void ModulationMatrix::setLfo (int index, float rateHz, LfoShape shape) noexcept
+{
+    jassert (juce::isPositiveAndBelow (index, numLfos));
+
+    auto& lfo = lfos[(size_t) index];
+    lfo.rateHz = rateHz;
+    lfo.phasePerSample = (float) (rateHz / sampleRate);
+    lfo.shape = shape;
+}
+
+void ModulationMatrix::setEnvelope (float attackMs, float releaseMs) noexcept
+{
+    if (attackMs == envelopeAttackMs && releaseMs == envelopeReleaseMs)
+        return;
+
+    envelopeAttackMs = attackMs;
+    envelopeReleaseMs = releaseMs;
+    updateEnvelopeCoefficients();
+}
+
+void ModulationMatrix::updateEnvelopeCoefficients() noexcept
+{
+    // One-pole coefficients per control interval rather than per sample.
+    const auto coefficientFor = [this] (float timeMs)
+    {
+        return (float) std::exp (-controlInterval / (juce::jmax (0.01, (double) timeMs) / 1000.0 * sampleRate));
+    };
+
+    attackCoefficient = coefficientFor (envelopeAttackMs);
+    releaseCoefficient = coefficientFor (envelopeReleaseMs);
+}
+
+void ModulationMatrix::setSlot (int index, Source source, Destination destination, float amount) noexcept
+{
+    jassert (juce::isPositiveAndBelow (index, numSlots));
+
+    auto& slot = slots[(size_t) index];
+    slot.targetSource = source;
+    slot.targetDestination = destination;
+    slot.targetAmount = amount;
+}
+
+bool ModulationMatrix::isActive() const noexcept
+{
+    for (const auto& slot : slots)
+        if (slot.amount != 0.0f || (slot.targetSource != Source::off && slot.targetAmount != 0.0f))
+            return true;
+
+    return false;
+}
+
+//==============================================================================
+template <typename SampleType>
+int ModulationMatrix::process (const juce::dsp::AudioBlock<SampleType>& input, int numChannels) noexcept
+{
+    const auto numSamples = (int) input.getNumSamples();
+    const auto numIntervals = getNumIntervals (numSamples);
+    jassert ((size_t) numIntervals <= values[0].size());
+
+    for (int interval = 0; interval < numIntervals; ++interval)
+    {
+        const auto start = interval * controlInterval;
+        const auto length = juce::jmin (controlInterval, numSamples - start);
+
+        // The follower sees one peak per interval.
+        auto peak = 0.0f;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto range = juce::FloatVectorOperations::findMinAndMax (input.getChannelPointer ((size_t) channel) + start, length);
+            peak = juce::jmax (peak, (float) juce::jmax (-range.getStart(), range.getEnd()));
+        }
+
+        const auto coefficient = peak > envelope ? attackCoefficient : releaseCoefficient;
+        envelope = juce::jmin (1.0f, peak + (envelope - peak) * coefficient);
+
+        for (auto& lfo : lfos)
+        {
+            lfo.phase += lfo.phasePerSample * (float) length;
+            lfo.phase -= std::floor (lfo.phase);
+            lfo.value = getLfoValue (lfo.shape, lfo.phase);
+        }
+
+        advanceSlots();
+
+        for (auto& destinationValues : values)
+            destinationValues[(size_t) interval] = 0.0f;
+
+        for (const auto& slot : slots)
+            if (slot.amount != 0.0f)
+                values[(size_t) slot.destination][(size_t) interval] += slot.amount * getSourceValue (slot.source);
+    }
+
+    return numIntervals;
+}
+
+void ModulationMatrix::advanceSlots() noexcept
+{
+    for (auto& slot : slots)
+    {
+        auto rerouting = slot.source != slot.targetSource || slot.destination != slot.targetDestination;
+
+        // A slot is only rerouted once it has faded out.
+        if (rerouting && slot.amount == 0.0f)
+        {
+            slot.source = slot.targetSource;
+            slot.destination = slot.targetDestination;
+            rerouting = false;
+        }
+
+        const auto target = (rerouting || slot.source == Source::off) ? 0.0f : slot.targetAmount;
+        slot.amount += juce::jlimit (-amountStep, amountStep, target - slot.amount);
+    }
+}
+
+float ModulationMatrix::getSourceValue (Source source) const noexcept
+{
+    switch (source)
+    {
+        case Source::lfo1:      return lfos[0].value;
+        case Source::lfo2:      return lfos[1].value;
+        case Source::envelope:  return envelope;
+        case Source::off:       break;
+    }
+
+    return 0.0f;
+}
+
+float ModulationMatrix::getLfoValue (LfoShape shape, float phase) noexcept
+{
+    switch (shape)
+    {
+        case LfoShape::triangle:  return 1.0f - 4.0f * std::abs (phase - 0.5f);
+        case LfoShape::saw:       return 2.0f * phase - 1.0f;
+        case LfoShape::square:    return phase < 0.5f ? 1.0f : -1.0f;
+        case LfoShape::sine:      break;
+    }
+
+    return std::sin (juce::MathConstants<float>::twoPi * phase);
+}
+
+//==============================================================================
+template int ModulationMatrix::process<float>  (const juce::dsp::AudioBlock<float>&, int) noexcept;
+template int ModulationMatrix::process<double> (const juce::dsp::AudioBlock<double>&, int) noexcept;
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.h
+
+    LFOs and an input envelope follower routed to the delay's settings.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Two LFOs and an envelope follower on the input, routed through numSlots
+    slots, each one a source, a destination and a bipolar amount.
+
+    Everything runs at a fixed control rate: one value per destination for
+    every controlInterval samples, which the delay engine then glides
+    between. The summed values are nominal, about -1 to 1; what they mean
+    for a destination is up to the caller.
+
+    Amount changes glide over amountGlideSeconds. A slot that changes source
+    or destination fades out and back in, so rerouting never jumps. With
+    every slot silent, isActive() is false and nothing needs to run.
+*/
+class ModulationMatrix
+{
+public:
+    enum class Source { off, lfo1, lfo2, envelope };
+    enum class Destination { cutoff, resonance, rate, width, numDestinations };
+    enum class LfoShape { sine, triangle, saw, square };
+
+    static constexpr int numLfos = 2;
+    static constexpr int numSlots = 4;
+    static constexpr int numDestinations = (int) Destination::numDestinations;
+    static constexpr int controlInterval = 32;
+    static constexpr double amountGlideSeconds = 0.05;
+
+    //==============================================================================
+    void prepare (double sampleRate, int maximumBlockSize);
+    void reset() noexcept;
+
+    void setLfo (int index, float rateHz, LfoShape shape) noexcept;
+    void setEnvelope (float attackMs, float releaseMs) noexcept;
+    void setSlot (int index, Source source, Destination destination, float amount) noexcept;
+
+    /** False once every slot has faded out and none is set to fade in. */
+    bool isActive() const noexcept;
+
+    //==============================================================================
+    /** Runs the sources over a block, one control interval at a time, and
+        returns the number of intervals. The input feeds the envelope follower.
+    */
+    template <typename SampleType>
+    int process (const juce::dsp::AudioBlock<SampleType>& input, int numChannels) noexcept;
+
+    /** The summed modulation at the end of each interval of the last process() call. */
+    const float* getValues (Destination destination) const noexcept   { return values[(size_t) destination].data(); }
+
+    static int getNumIntervals (int numSamples) noexcept              { return (numSamples + controlInterval - 1) / controlInterval; }
+
+private:
+    //==============================================================================
+    struct Lfo
+    {
+        float rateHz = 0.0f;
+        float phase = 0.0f;
+        float phasePerSample = 0.0f;
+        LfoShape shape = LfoShape::sine;
+        float value = 0.0f;
+    };
+
+    struct Slot
+    {
+        Source source = Source::off, targetSource = Source::off;
+        Destination destination = Destination::cutoff, targetDestination = Destination::cutoff;
+        float amount = 0.0f, targetAmount = 0.0f;
+    };
+
+    static float getLfoValue (LfoShape shape, float phase) noexcept;
+    float getSourceValue (Source source) const noexcept;
+    void advanceSlots() noexcept;
+    void updateEnvelopeCoefficients() noexcept;
+
+    //==============================================================================
+    double sampleRate = 44100.0;
+
+    std::array<Lfo, (size_t) numLfos> lfos;
+    std::array<Slot, (size_t) numSlots> slots;
+    float amountStep = 1.0f;
+
+    float envelope = 0.0f;
+    float envelopeAttackMs = 10.0f, envelopeReleaseMs = 200.0f;
+    float attackCoefficient = 0.0f, releaseCoefficient = 0.0f;
+
+    std::array<std::vector<float>, (size_t) numDestinations> values;
+};
@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    MultichannelDelay.cpp
+
+  ==============================================================================
+*/
+
+#include "MultichannelDelay.h"
+
+//==============================================================================
+template <typename SampleType>
+void MultichannelDelay<SampleType>::prepare (const juce::dsp::ProcessSpec& spec, double maxDelayMs)
+{
+    const auto numPairs = ((int) spec.numChannels + 1) / 2;
+
+    if (numPairs != numEngines)
+    {
+        engines = std::make_unique<DelayEngine<SampleType>[]> ((size_t) numPairs);
+        numEngines = numPairs;
+    }
+
+    // Each engine only ever sees its own pair.
+    auto pairSpec = spec;
+    pairSpec.numChannels = juce::jmin (spec.numChannels, (juce::uint32) 2);
+
+    forEachEngine ([&] (auto& engine) { engine.prepare (pairSpec, maxDelayMs); });
+
+    updateWorkers();
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::updateWorkers()
+{
+    // The audio thread takes a share of the pairs itself.
+    const auto numCores = juce::SystemStats::getNumCpus();
+    const auto wanted = parallelProcessing.load() && numEngines >= minPairsForWorkers;
+    workers.setNumWorkers (wanted ? juce::jmin (numEngines, numCores) - 1 : 0);
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::reset()
+{
+    forEachEngine ([] (auto& engine) { engine.reset(); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::release()
+{
+    workers.setNumWorkers (0);
+    engines.reset();
+    numEngines = 0;
+}
+
+//==============================================================================
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setFilterType (FilterType newType) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setFilterType (newType); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setCutoffFrequency (SampleType newCutoffHz)
+{
+    forEachEngine ([=] (auto& engine) { engine.setCutoffFrequency (newCutoffHz); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setResonance (SampleType newResonance)
+{
+    forEachEngine ([=] (auto& engine) { engine.setResonance (newResonance); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setFeedback (SampleType newFeedback) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setFeedback (newFeedback); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setInterpolation (DelayInterpolation newInterpolation) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setInterpolation (newInterpolation); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setSaturation (SaturationShape newShape, SampleType newDrive) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setSaturation (newShape, newDrive); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::allocateOversampling (int order, bool useLinearPhase)
+{
+    forEachEngine ([=] (auto& engine) { engine.allocateOversampling (order, useLinearPhase); });
+}
+
+template <typename SampleType>
+bool MultichannelDelay<SampleType>::setOversampling (int newOrder, bool useLinearPhase) noexcept
+{
+    // Every engine is allocated together, so they all switch or none does.
+    auto switched = true;
+    forEachEngine ([&] (auto& engine) { switched = engine.setOversampling (newOrder, useLinearPhase) && switched; });
+    return switched;
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setModulationEnabled (bool shouldBeEnabled) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setModulationEnabled (shouldBeEnabled); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setModulationRate (SampleType newRateHz) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setModulationRate (newRateHz); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setModulationDepth (SampleType newDepth) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setModulationDepth (newDepth); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setModulationFeedback (SampleType newFeedback) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setModulationFeedback (newFeedback); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setDelay (SampleType newDelayLeft, SampleType newDelayRight) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setDelay (newDelayLeft, newDelayRight); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::startCrossfade() noexcept
+{
+    forEachEngine ([] (auto& engine) { engine.startCrossfade(); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setControlModulation (const ControlModulation* newControl) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setControlModulation (newControl); });
+}
+
+template <typename SampleType>
+int MultichannelDelay<SampleType>::getMaxDelayInSamples() const noexcept
+{
+    return numEngines > 0 ? engines[0].getMaxDelayInSamples() : 0;
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::allocateLongDelay (double maxDelayMs)
+{
+    forEachEngine ([=] (auto& engine) { engine.allocateLongDelay (maxDelayMs); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::releaseLongDelay()
+{
+    forEachEngine ([] (auto& engine) { engine.releaseLongDelay(); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setLongDelayEnabled (bool shouldBeEnabled) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setLongDelayEnabled (shouldBeEnabled); });
+}
+
+template <typename SampleType>
+size_t MultichannelDelay<SampleType>::getMemoryUsageInBytes() const noexcept
+{
+    size_t total = 0;
+
+    for (int i = 0; i < numEngines; ++i)
+        total += engines[(size_t) i].getMemoryUsageInBytes();
+
+    return total;
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setNumTaps (int newNumTaps) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setNumTaps (newNumTaps); });
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::setTap (int index, SampleType delayInSamples, SampleType gain, SampleType pan) noexcept
+{
+    forEachEngine ([=] (auto& engine) { engine.setTap (index, delayInSamples, gain, pan); });
+}
+
+//==============================================================================
+template <typename SampleType>
+void MultichannelDelay<SampleType>::process (const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept
+{
+    currentBlock = context.getOutputBlock();
+
+    const auto numPairs = juce::jmin (numEngines, ((int) currentBlock.getNumChannels() + 1) / 2);
+
+    if (parallelProcessing.load (std::memory_order_relaxed) && workers.getNumWorkers() > 0 && numPairs >= minPairsForWorkers)
+    {
+        workers.run (numPairs, &MultichannelDelay::processPairJob, this);
+    }
+    else
+    {
+        for (int pair = 0; pair < numPairs; ++pair)
+            processPair (pair);
+    }
+
+    currentBlock = {};
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::processPair (int index) noexcept
+{
+    const auto firstChannel = (size_t) index * 2;
+    auto pairBlock = currentBlock.getSubsetChannelBlock (firstChannel, juce::jmin ((size_t) 2, currentBlock.getNumChannels() - firstChannel));
+
+    engines[(size_t) index].process (juce::dsp::ProcessContextReplacing<SampleType> (pairBlock));
+}
+
+template <typename SampleType>
+void MultichannelDelay<SampleType>::processPairJob (void* context, int index) noexcept
+{
+    static_cast<MultichannelDelay*> (context)->processPair (index);
+}
+
+//==============================================================================
+template class MultichannelDelay<float>;
+template class MultichannelDelay<double>;
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    MultichannelDelay.h
+
+    The delay engine for buses wider than stereo.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayEngine.h"
+#include "RealtimeWorkerPool.h"
+
+//==============================================================================
+/**
+    Runs one DelayEngine per pair of adjacent channels.
+
+    Channels are paired in bus order (L/R, C/LFE, Ls/Rs, ... for the
+    discrete layouts up to 7.1.4), so each pair keeps the fused two-lane
+    loop of the stereo engine, and an odd last channel runs on its own
+    engine's left lane. The engines sit in one contiguous array and every
+    setting is forwarded to all of them.
+
+    With parallel processing on and at least minPairsForWorkers pairs, the
+    pairs are shared between the audio thread and a RealtimeWorkerPool. The
+    switch is safe from the audio thread: the pool only has threads while
+    it's on, and updateWorkers(), called off the audio thread, starts or
+    stops them to match. Until then the pairs run on the audio thread.
+*/
+template <typename SampleType>
+class MultichannelDelay
+{
+public:
+    using FilterType = typename DelayEngine<SampleType>::FilterType;
+
+    //==============================================================================
+    void prepare (const juce::dsp::ProcessSpec& spec, double maxDelayMs);
+    void reset();
+
+    /** Frees every engine and stops the workers; prepare() again before processing. */
+    void release();
+
+    //==============================================================================
+    void setFilterType (FilterType newType) noexcept;
+    void setCutoffFrequency (SampleType newCutoffHz);
+    void setResonance (SampleType newResonance);
+    void setFeedback (SampleType newFeedback) noexcept;
+    void setInterpolation (DelayInterpolation newInterpolation) noexcept;
+    void setSaturation (SaturationShape newShape, SampleType newDrive) noexcept;
+    /** See DelayEngine::allocateOversampling(). */
+    void allocateOversampling (int order, bool useLinearPhase);
+    /** See DelayEngine::setOversampling(). */
+    bool setOversampling (int newOrder, bool useLinearPhase) noexcept;
+
+    void setModulationEnabled (bool shouldBeEnabled) noexcept;
+    void setModulationRate (SampleType newRateHz) noexcept;
+    void setModulationDepth (SampleType newDepth) noexcept;
+    void setModulationFeedback (SampleType newFeedback) noexcept;
+
+    /** The left delay goes to the first channel of every pair, the right delay to the second. */
+    void setDelay (SampleType newDelayLeft, SampleType newDelayRight) noexcept;
+
+    /** See DelayEngine::startCrossfade(). */
+    void startCrossfade() noexcept;
+
+    /** See DelayEngine::setControlModulation(); every pair gets the same modulation. */
+    void setControlModulation (const ControlModulation* newControl) noexcept;
+
+    int getMaxDelayInSamples() const noexcept;
+
+    /** See DelayEngine::allocateLongDelay(); allocates for every pair. */
+    void allocateLongDelay (double maxDelayMs);
+    void releaseLongDelay();
+    void setLongDelayEnabled (bool shouldBeEnabled) noexcept;
+
+    /** The delay memory held by every pair together, in bytes. */
+    size_t getMemoryUsageInBytes() const noexcept;
+
+    void setNumTaps (int newNumTaps) noexcept;
+    void setTap (int index, SampleType delayInSamples, SampleType gain, SampleType pan) noexcept;
+
+    /** Shares the channel pairs out to the worker threads when there are enough of them. */
+    void setParallelProcessingEnabled (bool shouldBeEnabled) noexcept  { parallelProcessing.store (shouldBeEnabled); }
+
+    /** Starts or stops worker threads to follow setParallelProcessingEnabled(). Not for the audio thread. */
+    void updateWorkers();
+
+    static constexpr int minPairsForWorkers = 4;
+
+    //==============================================================================
+    /** Replaces every channel of the context with the wet signal. */
+    void process (const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept;
+
+private:
+    //==============================================================================
+    template <typename Function>
+    void forEachEngine (Function&& function)
+    {
+        for (int i = 0; i < numEngines; ++i)
+            function (engines[(size_t) i]);
+    }
+
+    void processPair (int index) noexcept;
+    static void processPairJob (void* context, int index) noexcept;
+
+    //==============================================================================
+    std::unique_ptr<DelayEngine<SampleType>[]> engines;
+    int numEngines = 0;
+
+    RealtimeWorkerPool workers;
+    std::atomic<bool> parallelProcessing { false };
+
+    // Only valid during process(), for the workers to pick their pair from.
+    juce::dsp::AudioBlock<SampleType> currentBlock;
+};
@@ -0,0 +1,32 @@
+/*
+  ==============================================================================
+
+    ParameterRamp.cpp
+
+    Per-sample parameter ramps rendered a block at a time.
+
+  ==============================================================================
+*/
+
+#include "ParameterRamp.h"
+
+//==============================================================================
+template <typename SampleType>
+void ParameterRamp<SampleType>::prepare (double sampleRate, int newMaximumBlockSize, double rampLengthSeconds)
+{
+    jassert (sampleRate > 0.0 && newMaximumBlockSize > 0);
+
+    rampLengthInSamples = juce::roundToInt (rampLengthSeconds * sampleRate);
+
+    if (buffer == nullptr || juce::jmax (1, newMaximumBlockSize) != maximumBlockSize)
+    {
+        maximumBlockSize = juce::jmax (1, newMaximumBlockSize);
+        buffer.allocate ((size_t) maximumBlockSize, false);
+    }
+
+    setCurrentAndTargetValue (target);
+}
+
+//==============================================================================
+template class ParameterRamp<float>;
+template class ParameterRamp<double>;
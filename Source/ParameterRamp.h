@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    ParameterRamp.h
+
+    Per-sample parameter ramps rendered a block at a time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A linear glide towards a target value, rendered into a preallocated
+    block buffer.
+
+    The ramp length is set in seconds, so a glide takes the same time
+    whatever the host block size. Each block is a plain arithmetic series,
+    and once the target has been reached getNextBlock() returns nullptr
+    without touching the buffer, so a settled parameter costs one branch
+    per block.
+*/
+template <typename SampleType>
+class ParameterRamp
+{
+public:
+    //==============================================================================
+    /** Allocates the block buffer, unless it's already that size, and sets how
+        long a glide to a new target takes.
+    */
+    void prepare (double sampleRate, int maximumBlockSize, double rampLengthSeconds);
+
+    /** Jumps straight to a value. */
+    void setCurrentAndTargetValue (SampleType newValue) noexcept
+    {
+        current = target = newValue;
+        countdown = 0;
+    }
+
+    /** Starts a glide from the current value; a target equal to the current one is ignored. */
+    void setTargetValue (SampleType newValue) noexcept
+    {
+        if (newValue == target)
+            return;
+
+        if (rampLengthInSamples <= 0)
+        {
+            setCurrentAndTargetValue (newValue);
+            return;
+        }
+
+        target = newValue;
+        countdown = rampLengthInSamples;
+        step = (target - current) / static_cast<SampleType> (countdown);
+    }
+
+    SampleType getCurrentValue() const noexcept    { return current; }
+    SampleType getTargetValue() const noexcept     { return target; }
+    bool isSmoothing() const noexcept              { return countdown > 0; }
+
+    //==============================================================================
+    /** Renders the next numSamples values and returns them, or returns nullptr
+        when the value is settled and getCurrentValue() holds for the whole block.
+    */
+    const SampleType* getNextBlock (int numSamples) noexcept
+    {
+        if (countdown <= 0)
+            return nullptr;
+
+        jassert (numSamples <= maximumBlockSize);
+        numSamples = juce::jmin (numSamples, maximumBlockSize);
+
+        auto* values = buffer.get();
+        const auto numRamped = juce::jmin (numSamples, countdown);
+
+        for (int i = 0; i < numRamped; ++i)
+            values[i] = current + step * static_cast<SampleType> (i + 1);
+
+        countdown -= numRamped;
+        current = countdown > 0 ? values[numRamped - 1] : target;
+
+        if (numRamped < numSamples)
+            juce::FloatVectorOperations::fill (values + numRamped, target, numSamples - numRamped);
+
+        return values;
+    }
+
+private:
+    //==============================================================================
+    juce::HeapBlock<SampleType> buffer;
+    int maximumBlockSize = 0;
+    int rampLengthInSamples = 0;
+    int countdown = 0;
+    SampleType current = 0, target = 0, step = 0;
+};
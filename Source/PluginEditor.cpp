@@ -1,95 +1,193 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-FilteredDelayAudioProcessorEditor::FilteredDelayAudioProcessorEditor (FilteredDelayAudioProcessor& p, juce::AudioProcessorValueTreeState& vts)
-    : AudioProcessorEditor (&p), audioProcessor (p)
-{
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (1000, 500);
-    
-    addAndMakeVisible(syncButton);
-    addAndMakeVisible(syncRateMenu);
-    addAndMakeVisible(rateDial);
-    addAndMakeVisible(mixDial);
-    addAndMakeVisible(feedbackDial);
-    addAndMakeVisible(widthDial);
-    addAndMakeVisible(filterTypeMenu);
-    addAndMakeVisible(cutoffDial);
-    addAndMakeVisible(resonanceDial);
-    addAndMakeVisible(modBypassButton);
-    addAndMakeVisible(modRate);
-    addAndMakeVisible(modDepth);
-    
-    syncButtonAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(vts, "BPM_SYNC", syncButton));
-    syncRateMenuAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(vts, "SYNC_RATE_CHOICE", syncRateMenu));
-//    rateDialAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(vts, "RATE", rateDial));
-    mixDialAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(vts, "MIX", mixDial));
-    feedbackDialAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(vts, "FEEDBACK", feedbackDial));
-
-    
-    rateDial.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
-    rateDial.setTextBoxStyle(juce::Slider::TextBoxBelow, true, 40, 20);
-    feedbackDial.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
-    feedbackDial.setTextBoxStyle(juce::Slider::TextBoxBelow, true, 40, 20);
-
-    
-    
-    
-    
-
-    
-
-    
-}
-
-FilteredDelayAudioProcessorEditor::~FilteredDelayAudioProcessorEditor()
-{
-}
-
-//==============================================================================
-void FilteredDelayAudioProcessorEditor::paint (juce::Graphics& g)
-{
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-//    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-    juce::Image background = juce::ImageCache::getFromMemory (BinaryData::background2_png, BinaryData::background2_pngSize);
-        g.drawImageAt (background, 0, 0);
-    g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-//    g.setColour(juce::Colours::red);
-//    g.fillRect(delaySection);
-//    g.setColour(juce::Colours::green);
-//    g.fillRect(filterSection);
-//    g.setColour(juce::Colours::blue);
-//    g.fillRect(modSection);
-    
-
-}
-
-void FilteredDelayAudioProcessorEditor::resized()
-{
-    const int border = 20;
-    const int topRowSliderWidth = 200 - 30;
-    const int topRowSliderHeight = 250 - border - 40;
-    const int menuWidth = 100;
-    delaySection.setBounds(0, 0, 400, 500);
-    filterSection.setBounds(400, 0, 400, 500);
-    modSection.setBounds(800, 0, 200, 500);
-    
-    syncRateMenu.setBounds(delaySection.getWidth() / 2 + 35, delaySection.getHeight() / 2 - 20, menuWidth, 30);
-    syncButton.setBounds(90, delaySection.getHeight() / 2 - 20, 30, 30);
-    rateDial.setBounds(delaySection.getX() + border, delaySection.getY() + border, topRowSliderWidth, topRowSliderHeight);
-    feedbackDial.setBounds(delaySection.getWidth() / 2, delaySection.getY() + border, topRowSliderWidth, topRowSliderHeight);
-
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+FilteredDelayAudioProcessorEditor::FilteredDelayAudioProcessorEditor (FilteredDelayAudioProcessor& p, juce::AudioProcessorValueTreeState& vts)
+    : AudioProcessorEditor (&p), audioProcessor (p)
+{
+    // Make sure that before the constructor has finished, you've set the
+    // editor's size to whatever you need it to be.
+    setSize (1000, 500);
+    
+    addAndMakeVisible(syncButton);
+    addAndMakeVisible(syncRateMenu);
+    addAndMakeVisible(rateDial);
+    addAndMakeVisible(mixDial);
+    addAndMakeVisible(feedbackDial);
+    addAndMakeVisible(widthDial);
+    addAndMakeVisible(delayTimeLabel);
+    addAndMakeVisible(interpolationMenu);
+    addAndMakeVisible(oversamplingMenu);
+    addAndMakeVisible(filterTypeMenu);
+    addAndMakeVisible(cutoffDial);
+    addAndMakeVisible(resonanceDial);
+    addAndMakeVisible(modBypassButton);
+    addAndMakeVisible(modRate);
+    addAndMakeVisible(modDepth);
+    addAndMakeVisible(modFeedback);
+    addAndMakeVisible(responseCurve);
+    addAndMakeVisible(levelMeter);
+   #if FILTERED_DELAY_PROFILING
+    addAndMakeVisible(cpuMeterLabel);
+   #endif
+    
+    syncButtonAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(vts, "BPM_SYNC", syncButton));
+    syncRateMenuAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(vts, "SYNC_RATE_CHOICE", syncRateMenu));
+    if (auto* interpolationChoice = dynamic_cast<juce::AudioParameterChoice*>(vts.getParameter("INTERPOLATION")))
+        interpolationMenu.addItemList(interpolationChoice->choices, 1);
+    interpolationMenuAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(vts, "INTERPOLATION", interpolationMenu));
+    if (auto* oversamplingChoice = dynamic_cast<juce::AudioParameterChoice*>(vts.getParameter("OVERSAMPLING")))
+        oversamplingMenu.addItemList(oversamplingChoice->choices, 1);
+    oversamplingMenuAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(vts, "OVERSAMPLING", oversamplingMenu));
+//    rateDialAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(vts, "RATE", rateDial));
+    mixDialAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(vts, "MIX", mixDial));
+    feedbackDialAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(vts, "FEEDBACK", feedbackDial));
+    modFeedbackAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(vts, "MOD_FB", modFeedback));
+
+    
+    rateDial.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    rateDial.setTextBoxStyle(juce::Slider::TextBoxBelow, true, 40, 20);
+    feedbackDial.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    feedbackDial.setTextBoxStyle(juce::Slider::TextBoxBelow, true, 40, 20);
+    modFeedback.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    modFeedback.setTextBoxStyle(juce::Slider::TextBoxBelow, true, 40, 20);
+    
+    delayTimeLabel.setJustificationType(juce::Justification::centred);
+    delayTimeLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+   #if FILTERED_DELAY_PROFILING
+    cpuMeterLabel.setJustificationType(juce::Justification::centredLeft);
+    cpuMeterLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+   #endif
+    
+    filterTypeValue = vts.getRawParameterValue("FILTER_TYPE");
+    cutoffValue = vts.getRawParameterValue("CUTOFF");
+    resonanceValue = vts.getRawParameterValue("RESONANCE");
+    updateResponseDisplay();
+    
+    // The synced delay time isn't written back into RATE, so it's polled from
+    // the processor for display, along with the filter settings and the meter.
+    startTimerHz(refreshRateHz);
+
+    
+    
+    
+    
+
+    
+
+    
+}
+
+FilteredDelayAudioProcessorEditor::~FilteredDelayAudioProcessorEditor()
+{
+    stopTimer();
+}
+
+//==============================================================================
+void FilteredDelayAudioProcessorEditor::paint (juce::Graphics& g)
+{
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+//    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+    juce::Image background = juce::ImageCache::getFromMemory (BinaryData::background2_png, BinaryData::background2_pngSize);
+        g.drawImageAt (background, 0, 0);
+    g.setColour (juce::Colours::white);
+    g.setFont (15.0f);
+//    g.setColour(juce::Colours::red);
+//    g.fillRect(delaySection);
+//    g.setColour(juce::Colours::green);
+//    g.fillRect(filterSection);
+//    g.setColour(juce::Colours::blue);
+//    g.fillRect(modSection);
+    
+
+}
+
+void FilteredDelayAudioProcessorEditor::resized()
+{
+    const int border = 20;
+    const int topRowSliderWidth = 200 - 30;
+    const int topRowSliderHeight = 250 - border - 40;
+    const int menuWidth = 100;
+    delaySection.setBounds(0, 0, 400, 500);
+    filterSection.setBounds(400, 0, 400, 500);
+    modSection.setBounds(800, 0, 200, 500);
+    
+    syncRateMenu.setBounds(delaySection.getWidth() / 2 + 35, delaySection.getHeight() / 2 - 20, menuWidth, 30);
+    syncButton.setBounds(90, delaySection.getHeight() / 2 - 20, 30, 30);
+    rateDial.setBounds(delaySection.getX() + border, delaySection.getY() + border, topRowSliderWidth, topRowSliderHeight);
+    feedbackDial.setBounds(delaySection.getWidth() / 2, delaySection.getY() + border, topRowSliderWidth, topRowSliderHeight);
+    delayTimeLabel.setBounds(syncRateMenu.getX(), syncRateMenu.getBottom() + 5, menuWidth, 20);
+    interpolationMenu.setBounds(syncRateMenu.getX(), delayTimeLabel.getBottom() + 5, menuWidth, 30);
+    oversamplingMenu.setBounds(filterSection.getX() + border, filterSection.getY() + border, menuWidth, 30);
+    levelMeter.setBounds(filterSection.getRight() - border - 12, oversamplingMenu.getBottom() + 10, 12, 160);
+    responseCurve.setBounds(oversamplingMenu.getX(), levelMeter.getY(), levelMeter.getX() - 8 - oversamplingMenu.getX(), levelMeter.getHeight());
+    modFeedback.setBounds(modSection.getX() + border, modSection.getBottom() - border - 120, modSection.getWidth() - 2 * border, 120);
+   #if FILTERED_DELAY_PROFILING
+    cpuMeterLabel.setBounds(filterSection.getX() + border, filterSection.getBottom() - border - 20, filterSection.getWidth() - 2 * border, 20);
+   #endif
+
+    // This is generally where you'll want to lay out the positions of any
+    // subcomponents in your editor..
+}
+
+void FilteredDelayAudioProcessorEditor::timerCallback()
+{
+   #if FILTERED_DELAY_PROFILING
+    updateCpuMeter();
+   #endif
+    
+    updateResponseDisplay();
+
+    const auto delayTimeMs = audioProcessor.getEffectiveDelayTimeMs();
+
+    if (std::abs(delayTimeMs - displayedDelayTimeMs) < 0.05f)
+        return;
+
+    displayedDelayTimeMs = delayTimeMs;
+    delayTimeLabel.setText(juce::String(delayTimeMs, 1) + " ms", juce::dontSendNotification);
+}
+
+void FilteredDelayAudioProcessorEditor::updateResponseDisplay()
+{
+    // Both components only repaint when what they show has actually moved.
+    if (filterTypeValue != nullptr && cutoffValue != nullptr && resonanceValue != nullptr)
+        responseCurve.setResponse((int) filterTypeValue->load(), cutoffValue->load(), resonanceValue->load(), audioProcessor.getSampleRate());
+
+    levelMeter.setLevel(audioProcessor.getAnalysisFeed().getMeterLevel());
+}
+
+#if FILTERED_DELAY_PROFILING
+void FilteredDelayAudioProcessorEditor::updateCpuMeter()
+{
+    // Only the newest snapshot is shown, but the FIFO is drained so it never fills up.
+    ProcessProfiler::Snapshot snapshot;
+    bool gotSnapshot = false;
+
+    while (audioProcessor.getProfiler().popSnapshot(snapshot))
+        gotSnapshot = true;
+
+    if (! gotSnapshot)
+        return;
+
+    const auto& block = snapshot.stages[(size_t) ProcessProfiler::Stage::block];
+    const auto& delay = snapshot.stages[(size_t) ProcessProfiler::Stage::delay];
+    const auto& mixer = snapshot.stages[(size_t) ProcessProfiler::Stage::mixer];
+    const auto shareOfBlock = [&block] (const ProcessProfiler::StageStats& stage)
+    {
+        return block.meanCycles > 0.0 ? juce::String(100.0 * stage.meanCycles / block.meanCycles, 0) + "%" : juce::String("-");
+    };
+
+    cpuMeterLabel.setText("CPU " + juce::String(100.0 * snapshot.cpuLoad, 1) + "%"
+                          + "  delay " + shareOfBlock(delay) + "  mix " + shareOfBlock(mixer)
+                          + "  peak block " + juce::String(block.maximumCycles / juce::jmax(1.0, snapshot.cyclesPerSecond) * 1.0e6, 0) + " us",
+                          juce::dontSendNotification);
+}
+#endif
@@ -1,397 +1,1064 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-FilteredDelayAudioProcessor::FilteredDelayAudioProcessor()
-: juce::AudioProcessor(BusesProperties().withOutput ("Output", juce::AudioChannelSet::stereo(), true)),
-    treeState(*this, nullptr, "Parameters", createParameters())
-
-{
-    treeState.addParameterListener ("BPM_SYNC", this);
-    treeState.addParameterListener ("SYNC_RATE_CHOICE", this);
-    treeState.addParameterListener ("RATE", this);
-    treeState.addParameterListener ("FEEDBACK", this);
-    treeState.addParameterListener ("WIDTH", this);
-    treeState.addParameterListener ("MIX", this);
-    treeState.addParameterListener ("FILTER_TYPE", this);
-    treeState.addParameterListener ("CUTOFF", this);
-    treeState.addParameterListener ("RESONANCE", this);
-    treeState.addParameterListener ("MOD_BP", this);
-    treeState.addParameterListener ("MOD_RATE", this);
-    treeState.addParameterListener ("MOD_DEPTH", this);
-    treeState.addParameterListener ("MOD_FB", this);
-  
-}
-
-FilteredDelayAudioProcessor::~FilteredDelayAudioProcessor()
-{
-    treeState.removeParameterListener ("BPM_SYNC", this);
-    treeState.removeParameterListener ("SYNC_RATE_CHOICE", this);
-    treeState.removeParameterListener ("RATE", this);
-    treeState.removeParameterListener ("FEEDBACK", this);
-    treeState.removeParameterListener ("WIDTH", this);
-    treeState.removeParameterListener ("MIX", this);
-    treeState.removeParameterListener ("FILTER_TYPE", this);
-    treeState.removeParameterListener ("CUTOFF", this);
-    treeState.removeParameterListener ("RESONANCE", this);
-    treeState.removeParameterListener ("MOD_BP", this);
-    treeState.removeParameterListener ("MOD_RATE", this);
-    treeState.removeParameterListener ("MOD_DEPTH", this);
-    treeState.removeParameterListener ("MOD_FB", this);
-}
-
-//==============================================================================
-const juce::String FilteredDelayAudioProcessor::getName() const
-{
-    return JucePlugin_Name;
-}
-
-bool FilteredDelayAudioProcessor::acceptsMidi() const
-{
-   #if JucePlugin_WantsMidiInput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool FilteredDelayAudioProcessor::producesMidi() const
-{
-   #if JucePlugin_ProducesMidiOutput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool FilteredDelayAudioProcessor::isMidiEffect() const
-{
-   #if JucePlugin_IsMidiEffect
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-double FilteredDelayAudioProcessor::getTailLengthSeconds() const
-{
-    return 0.0;
-}
-
-int FilteredDelayAudioProcessor::getNumPrograms()
-{
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
-}
-
-int FilteredDelayAudioProcessor::getCurrentProgram()
-{
-    return 0;
-}
-
-void FilteredDelayAudioProcessor::setCurrentProgram (int index)
-{
-}
-
-const juce::String FilteredDelayAudioProcessor::getProgramName (int index)
-{
-    return {};
-}
-
-void FilteredDelayAudioProcessor::changeProgramName (int index, const juce::String& newName)
-{
-}
-
-//==============================================================================
-void FilteredDelayAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
-{
-    juce::dsp::ProcessSpec spec;
-    
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = getTotalNumOutputChannels();
-
-    filter.reset();
-    mixer.reset();
-    delayL.reset();
-    delayR.reset();
-    mod.reset();
-    
-    mixer.prepare(spec);
-    delayL.prepare(spec);
-    delayR.prepare(spec);
-    filter.prepare(spec);
-    mod.prepare(spec);
-    
-    mod.setCentreDelay(15.0f);
-    mod.setMix(0);
-    mod.setFeedback(0);
-    
-    for (auto& volume : delayFeedbackVolume)
-        volume.reset (spec.sampleRate, 0.05);
-    
-    delayTimeSmoothedValue.reset(sampleRate, 0.0025f);
-    delayOffsetSmoothedValue.reset(sampleRate, 0.0025f);
-  
-
-    std::fill (lastDelayOutputL.begin(), lastDelayOutputL.end(), 0.0f);
-    std::fill (lastDelayOutputR.begin(), lastDelayOutputR.end(), 0.0f);
-}
-
-void FilteredDelayAudioProcessor::releaseResources()
-{
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
-}
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-bool FilteredDelayAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
-{
-  #if JucePlugin_IsMidiEffect
-    juce::ignoreUnused (layouts);
-    return true;
-  #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
-        return false;
-
-    // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
-   #endif
-
-    return true;
-  #endif
-}
-#endif
-
-void FilteredDelayAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
-{
-   juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-    
-    juce::RangedAudioParameter* bpmSyncParameter = treeState.getParameter("BPM_SYNC");
-    juce::RangedAudioParameter* syncRateChoiceParameter = treeState.getParameter("SYNC_RATE_CHOICE");
-    const int subdivisionIndex = static_cast<int>(syncRateChoiceParameter->getValue() * subdivisions.size());
-    const float selectedSubdivisionValue = subdivisions[subdivisionIndex];
-    
-    double bpm {120};
-        if (auto bpmFromHost = *getPlayHead()->getPosition()->getBpm())
-            bpm = bpmFromHost;
-    
-    if (bpmSyncParameter->getValue())
-    {
-        float delayTimeInSamples = (60.0 / bpm) * selectedSubdivisionValue  * getSampleRate();
-        float delayTimeInMillisec =  delayTimeInSamples / getSampleRate() * 1000.0f;
-        treeState.getParameter("RATE")->beginChangeGesture();
-        treeState.getParameter("RATE")->setValueNotifyingHost(juce::NormalisableRange<float>(1.0f, 2000.0f, 1.0f).convertTo0to1(delayTimeInMillisec));
-        treeState.getParameter("RATE")->endChangeGesture();
-        
-        delayTimeSmoothedValue.setTargetValue(delayTimeInSamples);
-        delayOffsetSmoothedValue.setTargetValue(delayOffsetInSamples);
-        delayL.setDelay(delayTimeSmoothedValue.getNextValue() + delayOffsetSmoothedValue.getNextValue());
-        delayR.setDelay(delayTimeSmoothedValue.getNextValue());
-    }
-    else
-    {
-        delayTimeSmoothedValue.setTargetValue(delayTimeInSamples);
-        delayL.setDelay(delayTimeSmoothedValue.getNextValue() + delayOffsetSmoothedValue.getNextValue());
-        delayR.setDelay(delayTimeSmoothedValue.getNextValue());
-    }
-
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-     
-    const auto numChannels = juce::jmax (totalNumInputChannels, totalNumOutputChannels);
-    auto audioBlock = juce::dsp::AudioBlock<float> (buffer).getSubsetChannelBlock (0, (size_t) numChannels);
-    auto context = juce::dsp::ProcessContextReplacing<float> (audioBlock);
-    const auto& input = context.getInputBlock();
-    const auto& output = context.getOutputBlock();
-
-    mixer.pushDrySamples(input);
-    mod.process(context);
-    
-    for (size_t channel = 0; channel < totalNumInputChannels; ++channel)
-    {
-        auto *samplesIn = input.getChannelPointer(channel);
-        auto *samplesOut = output.getChannelPointer(channel);
-        
-        if (channel == 0)
-        {
-            for (size_t sample = 0; sample < input.getNumSamples(); ++sample)
-            {
-                auto input = samplesIn[sample] - lastDelayOutputL[channel];
-                delayL.pushSample((int) channel, input);
-                
-                auto wetL = delayL.popSample((int)channel);
-                wetL = filter.processSample((int)channel, wetL);
-                
-                samplesOut[sample] = wetL + lastDelayOutputL[channel];
-                lastDelayOutputL[channel] = samplesOut[sample] * delayFeedbackVolume[channel].getNextValue() * 0.5f;
-            }
-        }
-    
-        if (channel == 1)
-        {
-            for (size_t sample = 0; sample < input.getNumSamples(); ++sample)
-            {
-                auto input = samplesIn[sample] - lastDelayOutputR[channel];
-                delayR.pushSample((int) channel, input);
-                
-                auto wetR = delayR.popSample((int)channel);
-                wetR = filter.processSample((int)channel, wetR);
-                
-                samplesOut[sample] = wetR + lastDelayOutputR[channel];
-                lastDelayOutputR[channel] = samplesOut[sample] * delayFeedbackVolume[channel].getNextValue() * 0.5f;
-            }
-        }
-    }
-    mixer.mixWetSamples(output);
-}
-
-//==============================================================================
-bool FilteredDelayAudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
-
-juce::AudioProcessorEditor* FilteredDelayAudioProcessor::createEditor()
-{
-    return new FilteredDelayAudioProcessorEditor (*this, treeState);
-//    return new juce::GenericAudioProcessorEditor (*this);
-
-
-}
-
-//==============================================================================
-void FilteredDelayAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
-{
-    auto state = treeState.copyState();
-    std::unique_ptr<juce::XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
-}
-
-void FilteredDelayAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-{
-    std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
-
-    if (xmlState.get() != nullptr)
-        if (xmlState->hasTagName (treeState.state.getType()))
-            treeState.replaceState (juce::ValueTree::fromXml (*xmlState));
-}
-
-//==============================================================================
-// This creates new instances of the plugin..
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
-{
-    return new FilteredDelayAudioProcessor();
-}
-void FilteredDelayAudioProcessor::parameterChanged (const juce::String& parameterID, float newValue)
-{
-    
-    using filterType = juce::dsp::StateVariableTPTFilterType;
-  
-    if (parameterID == "RATE")
-    {
-        delayTimeInSamples = newValue / 1000.0 * getSampleRate();
-    }
-    
-    if (parameterID == "MIX")
-    {
-        mixer.setWetMixProportion (newValue);
-    }
-    
-    if (parameterID == "FEEDBACK")
-    {
-        const auto feedbackGain = newValue;
-
-        for (auto& volume : delayFeedbackVolume)
-            volume.setTargetValue (feedbackGain);
-    }
-    
-    if (parameterID == "WIDTH")
-    {
-        delayOffsetInSamples = newValue / 1000.0 * getSampleRate();
-        
-    }
-
-    if (parameterID == "FILTER_TYPE")
-    {
-        if (newValue == 0)
-            filter.setType(filterType::lowpass);
-
-        if (newValue == 1)
-            filter.setType(filterType::highpass);
-
-        if (newValue == 2)
-            filter.setType(filterType::bandpass);
-
-    }
-
-    if (parameterID == "CUTOFF")
-    {
-        filter.setCutoffFrequency (newValue);
-    }
-    
-    if (parameterID == "RESONANCE")
-    {
-        filter.setResonance(newValue);
-    }
-
-    if (parameterID == "MOD_BP")
-    {
-        if (newValue == false)
-            mod.setMix(1.0f);
-        if (newValue == true)
-            mod.setMix(0.0f);
-    }
-
-    if (parameterID == "MOD_RATE")
-    {
-        mod.setRate(newValue);
-    }
-
-    if (parameterID == "MOD_DEPTH")
-    {
-        mod.setDepth(newValue);
-    }
-}
-
-juce::AudioProcessorValueTreeState::ParameterLayout FilteredDelayAudioProcessor::createParameters()
-{
-    juce::AudioProcessorValueTreeState::ParameterLayout params;
-    
-    using Range = juce::NormalisableRange<float>;
-    using pID = juce::ParameterID;
-    
-    params.add (std::make_unique<juce::AudioParameterBool>  (pID {"BPM_SYNC", 1}, "Bpm Sync", true));
-    params.add (std::make_unique<juce::AudioParameterChoice>(pID {"SYNC_RATE_CHOICE", 1}, "Sync Rate Choice", juce::StringArray{ "16th", "16th Triplet", "16th Dotted",
-                                                                  "8th", "8th Triplet", "8th Dotted", "Quarter", "Quarter Triplet", "Quarter Dotted",
-                                                                  "Half", "Half Triplet", "Half Dotted", "Whole"}, 3));
-    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"RATE", 1}, "Rate", Range {1.0f, 2000.0f, 1.0}, 0, "ms"));
-    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"FEEDBACK", 1}, "Feedback", Range {0.0f, 1.0f, 0.01f}, 0.25f, "%"));
-    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"WIDTH", 1}, "Width", Range {0.0f, 5.0f, 0.1f}, 0.0f, "ms"));
-    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"MIX", 1}, "Mix", Range { 0.0f, 1.0f, 0.01f }, 0.0f, "%"));
-    params.add (std::make_unique<juce::AudioParameterChoice>(pID {"FILTER_TYPE", 1}, "Filter Type", juce::StringArray("Lowpass", "Highpass", "Bandpass"), 0));
-    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"CUTOFF", 1}, "Cutoff", Range {20.0f, 20000.0f, 1.0f, 0.2f}, 1000.f, "Hz"));
-    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"RESONANCE", 1}, "Resonance", Range {0.0f, 2.0f, 0.1f}, 0.707f));
-    params.add (std::make_unique<juce::AudioParameterBool>  (pID {"MOD_BP", 1}, "Mod Bypass", true));
-    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"MOD_RATE", 1}, "Mod Rate", Range{0.05f, 5.0f, 0.01f}, 1.0f, "Hz"));
-    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"MOD_DEPTH", 1}, "Mod Depth", Range{0.0f, 1.0f, 0.01f}, 0.15f));
-    return params;
-}
-
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+FilteredDelayAudioProcessor::FilteredDelayAudioProcessor()
+: juce::AudioProcessor(BusesProperties().withInput ("Input", juce::AudioChannelSet::stereo(), true)
+                                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)),
+    treeState(*this, nullptr, "Parameters", createParameters())
+
+{
+    // Sessions create plugins by the hundred, so nothing else happens here:
+    // the DSP, and the timer that looks after the long delay history, wait
+    // for prepareToPlay.
+}
+
+FilteredDelayAudioProcessor::~FilteredDelayAudioProcessor()
+{
+    stopTimer();
+}
+
+//==============================================================================
+const juce::String FilteredDelayAudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool FilteredDelayAudioProcessor::acceptsMidi() const
+{
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool FilteredDelayAudioProcessor::producesMidi() const
+{
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool FilteredDelayAudioProcessor::isMidiEffect() const
+{
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+double FilteredDelayAudioProcessor::getTailLengthSeconds() const
+{
+    const auto delayTimeMs = parameters.bpmSync->load() >= 0.5f ? effectiveDelayTimeMs.load()
+                           : parameters.longDelay->load() >= 0.5f ? parameters.longRate->load()
+                                                                   : parameters.rate->load();
+    const auto modulationIsOn = parameters.modBypass->load() < 0.5f;
+
+    return calculateTailLengthSeconds (delayTimeMs + parameters.width->load(),
+                                       parameters.feedback->load(),
+                                       parameters.resonance->load(),
+                                       modulationIsOn ? parameters.modFeedback->load() : 0.0f)
+         + longestTapMs.load() / 1000.0;
+}
+
+double FilteredDelayAudioProcessor::calculateTailLengthSeconds (float delayTimeMs, float feedback, float resonance, float modFeedback)
+{
+    // Each trip round the loop scales an echo by FEEDBACK * 0.5, and at most by
+    // the filter's resonant peak on top of that. The modulated tap adds its own
+    // unfiltered path.
+    const auto loopGain = feedback * 0.5 * juce::jmax (1.0, (double) resonance) + modFeedback;
+    const auto delaySeconds = delayTimeMs / 1000.0;
+
+    if (loopGain >= 0.999)
+        return std::numeric_limits<double>::infinity();
+
+    if (loopGain <= 0.0)
+        return delaySeconds;
+
+    const auto numRepeats = std::ceil (std::log (tailThresholdGain) / std::log (loopGain));
+    return delaySeconds * (1.0 + numRepeats);
+}
+
+int FilteredDelayAudioProcessor::getNumPrograms()
+{
+    return presetBank.getNumPresets();   // the factory bank and any loaded bank are never empty
+}
+
+int FilteredDelayAudioProcessor::getCurrentProgram()
+{
+    return currentProgram;
+}
+
+void FilteredDelayAudioProcessor::setCurrentProgram (int index)
+{
+    if (! juce::isPositiveAndBelow (index, presetBank.getNumPresets()))
+        return;
+
+    currentProgram = index;
+    applyParameterValues (presetParameters, presetBank.getPreset (index).values);
+}
+
+const juce::String FilteredDelayAudioProcessor::getProgramName (int index)
+{
+    return juce::isPositiveAndBelow (index, presetBank.getNumPresets()) ? presetBank.getPreset (index).name
+                                                                        : juce::String();
+}
+
+void FilteredDelayAudioProcessor::changeProgramName (int index, const juce::String& newName)
+{
+    presetBank.setPresetName (index, newName);
+}
+
+bool FilteredDelayAudioProcessor::loadPresetBank (const void* data, size_t sizeInBytes)
+{
+    if (! presetBank.loadFromBinary (data, sizeInBytes))
+        return false;
+
+    currentProgram = juce::jmin (currentProgram, presetBank.getNumPresets() - 1);
+    updateHostDisplay (ChangeDetails().withProgramChanged (true));
+    return true;
+}
+
+juce::MemoryBlock FilteredDelayAudioProcessor::getPresetBankData() const
+{
+    return presetBank.toBinary();
+}
+
+void FilteredDelayAudioProcessor::applyParameterValues (const juce::Array<juce::RangedAudioParameter*>& targets,
+                                                        const std::vector<float>& values)
+{
+    jassert ((size_t) targets.size() == values.size());
+
+    std::vector<float> normalisedValues (values.size());
+
+    for (int i = 0; i < targets.size(); ++i)
+        normalisedValues[(size_t) i] = targets[i]->convertTo0to1 (values[(size_t) i]);
+
+    // The lock is only held to flag the write, never across calls into the
+    // host, which may well call straight back into the plugin. Until the
+    // flag clears, the audio thread leaves every setting where it was; it
+    // then picks the whole set up at its next block and crossfades to it,
+    // instead of gliding to each value on its own.
+    {
+        const juce::SpinLock::ScopedLockType lock (parameterWriteLock);
+        ++programWritesInProgress;
+    }
+
+    for (int i = 0; i < targets.size(); ++i)
+        targets[i]->setValueNotifyingHost (normalisedValues[(size_t) i]);
+
+    {
+        const juce::SpinLock::ScopedLockType lock (parameterWriteLock);
+        --programWritesInProgress;
+        crossfadePending.store (true, std::memory_order_release);
+    }
+}
+
+//==============================================================================
+void FilteredDelayAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    juce::dsp::ProcessSpec spec;
+    
+    spec.sampleRate = sampleRate;
+    spec.maximumBlockSize = samplesPerBlock;
+    spec.numChannels = getTotalNumOutputChannels();
+
+    tempoSync.prepare(sampleRate);
+    profiler.prepare (sampleRate);
+    analysisFeed.prepare (sampleRate);
+    
+    updateModulationMatrix();
+    modulationMatrix.prepare (sampleRate, samplesPerBlock);
+    controlModulationRunning = false;
+
+    const auto numIntervals = (size_t) ModulationMatrix::getNumIntervals (juce::jmax (1, samplesPerBlock));
+
+    for (auto* values : { &controlCutoff, &controlResonance, &controlDelayLeft, &controlDelayRight })
+        values->assign (numIntervals, 0.0f);
+
+    controlModulation.intervalLength = ModulationMatrix::controlInterval;
+    controlModulation.cutoffHz = controlCutoff.data();
+    controlModulation.resonance = controlResonance.data();
+    controlModulation.delayOffsetLeft = controlDelayLeft.data();
+    controlModulation.delayOffsetRight = controlDelayRight.data();
+    
+    // WIDTH offsets the first channel of every pair, which only makes sense
+    // for speaker pairs; it would smear an ambisonic sound field.
+    ambisonicLayout = getChannelLayoutOfBus (false, 0).getAmbisonicOrder() >= 0;
+    
+    idle = false;
+    silentSamples = 0;
+
+    const juce::ScopedLock allocationLock (longDelayAllocationLock);
+
+    // Nothing is playing, so the long history can go straight away; it's
+    // allocated again below if it's still wanted.
+    floatDsp.delayEngine.setLongDelayEnabled (false);
+    doubleDsp.delayEngine.setLongDelayEnabled (false);
+    floatDsp.delayEngine.releaseLongDelay();
+    doubleDsp.delayEngine.releaseLongDelay();
+    longDelayStorage.store (LongDelayStorage::released);
+    longDelayRunning = false;
+    longDelayCanAllocate = true;
+    startTimer (longDelayPollMs);
+
+    // The host sets the precision before preparing, so only one set of DSP
+    // objects is ever allocated at a time; the other is freed in case the
+    // precision has changed since the last prepare.
+    if (isUsingDoublePrecision())
+    {
+        releaseDsp (floatDsp);
+        prepareDsp (doubleDsp, spec);
+    }
+    else
+    {
+        releaseDsp (doubleDsp);
+        prepareDsp (floatDsp, spec);
+    }
+
+    // Hosts ask for the tail after preparing, so this is what they have.
+    reportedTailLengthSeconds = getTailLengthSeconds();
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::prepareDsp (Dsp<SampleType>& dsp, const juce::dsp::ProcessSpec& spec)
+{
+    const auto sampleRate = spec.sampleRate;
+
+    dsp.dryBuffer.setSize ((int) spec.numChannels, (int) spec.maximumBlockSize);
+    dsp.mixRamp.prepare (sampleRate, (int) spec.maximumBlockSize, mixRampSeconds);
+    dsp.delayEngine.prepare(spec, maxRateMs + maxWidthMs + maxRateModulationMs);
+
+    // prepare() resets the DSP objects, so push every current value again.
+    appliedSettings = {};
+    updateOversamplingStorage (dsp);
+    updateDspSettings (dsp);
+    dsp.delayEngine.updateWorkers();
+
+    // Nothing is playing yet, so a wanted long history can be allocated and
+    // switched in straight away.
+    updateLongDelayStorage (dsp);
+    updateLongDelay (dsp);
+
+    // Start from the delays the first block will ask for, synced, long or
+    // free, rather than gliding in to them.
+    longestDelayInSamples = updateDelayTimes (dsp, 0);
+    dsp.delayEngine.reset();
+    dsp.mixRamp.setCurrentAndTargetValue (dsp.mixRamp.getTargetValue());
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::releaseDsp (Dsp<SampleType>& dsp)
+{
+    dsp.delayEngine.release();
+    dsp.mixRamp = {};
+    dsp.dryBuffer = juce::AudioBuffer<SampleType>();
+}
+
+void FilteredDelayAudioProcessor::releaseResources()
+{
+    stopTimer();
+
+    // The long history is the one big allocation that's optional, so it's
+    // dropped until playback starts again.
+    const juce::ScopedLock allocationLock (longDelayAllocationLock);
+
+    floatDsp.delayEngine.setLongDelayEnabled (false);
+    doubleDsp.delayEngine.setLongDelayEnabled (false);
+    floatDsp.delayEngine.releaseLongDelay();
+    doubleDsp.delayEngine.releaseLongDelay();
+    longDelayStorage.store (LongDelayStorage::released);
+    longDelayRunning = false;
+    longDelayCanAllocate = false;
+}
+
+size_t FilteredDelayAudioProcessor::getDelayMemoryUsageInBytes() const noexcept
+{
+    return floatDsp.delayEngine.getMemoryUsageInBytes() + doubleDsp.delayEngine.getMemoryUsageInBytes();
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool FilteredDelayAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+  #if JucePlugin_IsMidiEffect
+    juce::ignoreUnused (layouts);
+    return true;
+  #else
+    // Any discrete or ambisonic layout works: channels are processed in
+    // adjacent pairs, so a wider bus just runs more of them.
+    const auto& mainOutput = layouts.getMainOutputChannelSet();
+
+    if (mainOutput.isDisabled() || mainOutput.size() > maxNumChannels)
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+void FilteredDelayAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples (buffer, midiMessages);
+}
+
+void FilteredDelayAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples (buffer, midiMessages);
+}
+
+bool FilteredDelayAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::processSamples (juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused (midiMessages);
+    juce::ScopedNoDenormals noDenormals;
+
+    // The dry copy and the ramps are sized for the block size given to
+    // prepareToPlay, so anything longer is processed in pieces. Sub-blocks
+    // only point into the buffer, so this never allocates, however many
+    // channels there are.
+    const juce::dsp::AudioBlock<SampleType> block (buffer);
+    const auto maxSectionSize = (size_t) juce::jmax (1, getDsp<SampleType>().dryBuffer.getNumSamples());
+
+    for (size_t start = 0; start < block.getNumSamples(); start += maxSectionSize)
+        processSection (block.getSubBlock (start, juce::jmin (maxSectionSize, block.getNumSamples() - start)));
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::processSection (const juce::dsp::AudioBlock<SampleType>& block)
+{
+    auto& dsp = getDsp<SampleType>();
+    auto& dryBuffer = dsp.dryBuffer;
+    auto& mixRamp = dsp.mixRamp;
+    auto totalNumInputChannels  = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    const auto numSamples = (int) block.getNumSamples();
+    
+    FILTERED_DELAY_PROFILE_BLOCK (profiler, numSamples);
+    
+    {
+        FILTERED_DELAY_PROFILE_STAGE (profiler, parameters);
+
+        // While a program is being written, the DSP keeps its last settings.
+        const juce::SpinLock::ScopedTryLockType parameterLock (parameterWriteLock);
+
+        if (parameterLock.isLocked() && programWritesInProgress == 0)
+        {
+            if (crossfadePending.exchange (false, std::memory_order_acquire))
+                dsp.delayEngine.startCrossfade();
+
+            updateDspSettings (dsp);
+            updateModulationMatrix();
+            updateLongDelay (dsp);
+            longestDelayInSamples = updateDelayTimes (dsp, numSamples);
+        }
+    }
+
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        block.getSingleChannelBlock ((size_t) i).clear();
+    
+    // Once the input and everything still circulating have been silent for a
+    // whole delay period, the state can only produce silence, so the DSP is
+    // skipped until something arrives again. Only the dry gain is applied.
+    const auto inputIsSilent = isSilent (block, totalNumInputChannels);
+    
+    if (idle && inputIsSilent)
+    {
+        if (const auto* mixValues = mixRamp.getNextBlock (numSamples))
+        {
+            for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+            {
+                auto* samples = block.getChannelPointer (channel);
+
+                for (int i = 0; i < numSamples; ++i)
+                    samples[i] *= static_cast<SampleType> (1) - mixValues[i];
+            }
+        }
+        else
+        {
+            block.multiplyBy (static_cast<SampleType> (1) - mixRamp.getCurrentValue());
+        }
+
+        analysisFeed.pushPeak (0.0f, numSamples);
+        return;
+    }
+    
+    idle = false;
+     
+    const auto numChannels = juce::jmax (totalNumInputChannels, totalNumOutputChannels);
+    auto audioBlock = block.getSubsetChannelBlock (0, (size_t) numChannels);
+    auto context = juce::dsp::ProcessContextReplacing<SampleType> (audioBlock);
+    const auto& output = context.getOutputBlock();
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        juce::FloatVectorOperations::copy (dryBuffer.getWritePointer (channel), block.getChannelPointer ((size_t) channel), numSamples);
+
+    {
+        FILTERED_DELAY_PROFILE_STAGE (profiler, delay);
+        updateControlModulation (dsp, block, totalNumInputChannels);
+        dsp.delayEngine.process(context);
+    }
+    
+    const auto wetRange = output.findMinAndMax();
+    const auto wetPeak = juce::jmax (-wetRange.getStart(), wetRange.getEnd());
+    const auto wetIsSilent = wetPeak < static_cast<SampleType> (silenceThresholdGain);
+    analysisFeed.pushPeak (static_cast<float> (wetPeak), numSamples);
+    
+    {
+        FILTERED_DELAY_PROFILE_STAGE (profiler, mixer);
+        mixDryAndWet (dsp, block, numChannels);
+    }
+    
+    silentSamples = (inputIsSilent && wetIsSilent) ? silentSamples + numSamples : 0;
+    
+    // The matrix can stretch the delays by up to RATE's and WIDTH's modulation range.
+    const auto modulatedDelayInSamples = controlModulationRunning ? (maxRateModulationMs + maxWidthMs) / 1000.0f * static_cast<float> (getSampleRate()) : 0.0f;
+    
+    if (silentSamples > juce::jmax (longestDelayInSamples + modulatedDelayInSamples, longestTapMs.load() / 1000.0f * static_cast<float> (getSampleRate())))
+    {
+        idle = true;
+        silentSamples = 0;
+    }
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::mixDryAndWet (Dsp<SampleType>& dsp, const juce::dsp::AudioBlock<SampleType>& block, int numChannels) noexcept
+{
+    const auto numSamples = (int) block.getNumSamples();
+    const auto& dryBuffer = dsp.dryBuffer;
+
+    if (const auto* mixValues = dsp.mixRamp.getNextBlock (numSamples))
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = block.getChannelPointer ((size_t) channel);
+            const auto* dry = dryBuffer.getReadPointer (channel);
+
+            for (int i = 0; i < numSamples; ++i)
+                samples[i] = dry[i] + mixValues[i] * (samples[i] - dry[i]);
+        }
+
+        return;
+    }
+
+    const auto mix = dsp.mixRamp.getCurrentValue();
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* samples = block.getChannelPointer ((size_t) channel);
+        juce::FloatVectorOperations::multiply (samples, mix, numSamples);
+        juce::FloatVectorOperations::addWithMultiply (samples, dryBuffer.getReadPointer (channel), static_cast<SampleType> (1) - mix, numSamples);
+    }
+}
+
+template <typename SampleType>
+bool FilteredDelayAudioProcessor::isSilent (const juce::dsp::AudioBlock<SampleType>& block, int numChannels) noexcept
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const auto range = juce::FloatVectorOperations::findMinAndMax (block.getChannelPointer ((size_t) channel), (int) block.getNumSamples());
+
+        if (juce::jmax (-range.getStart(), range.getEnd()) >= static_cast<SampleType> (silenceThresholdGain))
+            return false;
+    }
+
+    return true;
+}
+
+//==============================================================================
+float FilteredDelayAudioProcessor::getEffectiveDelayTimeMs() const noexcept
+{
+    return effectiveDelayTimeMs.load();
+}
+
+bool FilteredDelayAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* FilteredDelayAudioProcessor::createEditor()
+{
+    return new FilteredDelayAudioProcessorEditor (*this, treeState);
+//    return new juce::GenericAudioProcessorEditor (*this);
+
+
+}
+
+//==============================================================================
+void FilteredDelayAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    auto state = treeState.copyState();
+    std::unique_ptr<juce::XmlElement> xml (state.createXml());
+    xml->setAttribute ("program", currentProgram);
+    copyXmlToBinary (*xml, destData);
+}
+
+void FilteredDelayAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
+
+    if (xmlState == nullptr || ! xmlState->hasTagName (treeState.state.getType()))
+        return;
+
+    // The values are parsed out here and written like a program change,
+    // rather than through replaceState(), so a restore while audio runs is
+    // picked up in one piece and crossfaded in. Parameters the state doesn't
+    // mention, such as ones added since it was saved, go back to their defaults.
+    juce::Array<juce::RangedAudioParameter*> targets;
+    std::vector<float> values;
+
+    for (auto* processorParameter : getParameters())
+    {
+        if (auto* parameter = dynamic_cast<juce::RangedAudioParameter*> (processorParameter))
+        {
+            auto value = parameter->convertFrom0to1 (parameter->getDefaultValue());
+
+            if (auto* parameterState = xmlState->getChildByAttribute ("id", parameter->getParameterID()))
+                value = (float) parameterState->getDoubleAttribute ("value", value);
+
+            targets.add (parameter);
+            values.push_back (value);
+        }
+    }
+
+    currentProgram = juce::jlimit (0, presetBank.getNumPresets() - 1, xmlState->getIntAttribute ("program", 0));
+    applyParameterValues (targets, values);
+}
+
+//==============================================================================
+FilteredDelayAudioProcessor::Parameters::Parameters (juce::AudioProcessorValueTreeState& state)
+    : bpmSync        (state.getRawParameterValue ("BPM_SYNC")),
+      syncRateChoice (state.getRawParameterValue ("SYNC_RATE_CHOICE")),
+      rate           (state.getRawParameterValue ("RATE")),
+      feedback       (state.getRawParameterValue ("FEEDBACK")),
+      saturation     (state.getRawParameterValue ("SATURATION")),
+      drive          (state.getRawParameterValue ("DRIVE")),
+      width          (state.getRawParameterValue ("WIDTH")),
+      mix            (state.getRawParameterValue ("MIX")),
+      filterType     (state.getRawParameterValue ("FILTER_TYPE")),
+      cutoff         (state.getRawParameterValue ("CUTOFF")),
+      resonance      (state.getRawParameterValue ("RESONANCE")),
+      modBypass      (state.getRawParameterValue ("MOD_BP")),
+      modRate        (state.getRawParameterValue ("MOD_RATE")),
+      modDepth       (state.getRawParameterValue ("MOD_DEPTH")),
+      modFeedback    (state.getRawParameterValue ("MOD_FB")),
+      interpolation  (state.getRawParameterValue ("INTERPOLATION")),
+      oversampling   (state.getRawParameterValue ("OVERSAMPLING")),
+      oversamplingFilter (state.getRawParameterValue ("OVERSAMPLING_FILTER")),
+      tapCount       (state.getRawParameterValue ("TAP_COUNT")),
+      tapSpacing     (state.getRawParameterValue ("TAP_SPACING")),
+      tapSync        (state.getRawParameterValue ("TAP_SYNC")),
+      tapSyncRate    (state.getRawParameterValue ("TAP_SYNC_RATE")),
+      tapDecay       (state.getRawParameterValue ("TAP_DECAY")),
+      tapSpread      (state.getRawParameterValue ("TAP_SPREAD")),
+      parallelChannels (state.getRawParameterValue ("PARALLEL_CHANNELS")),
+      longDelay      (state.getRawParameterValue ("LONG_DELAY")),
+      longRate       (state.getRawParameterValue ("LONG_RATE")),
+      envelopeAttack (state.getRawParameterValue ("ENV_ATTACK")),
+      envelopeRelease (state.getRawParameterValue ("ENV_RELEASE"))
+{
+    for (size_t lfo = 0; lfo < lfoRate.size(); ++lfo)
+    {
+        const auto prefix = "LFO" + juce::String ((int) lfo + 1);
+        lfoRate[lfo]  = state.getRawParameterValue (prefix + "_RATE");
+        lfoShape[lfo] = state.getRawParameterValue (prefix + "_SHAPE");
+        jassert (lfoRate[lfo] != nullptr && lfoShape[lfo] != nullptr);
+    }
+
+    for (size_t slot = 0; slot < modSource.size(); ++slot)
+    {
+        const auto prefix = "MOD" + juce::String ((int) slot + 1);
+        modSource[slot]      = state.getRawParameterValue (prefix + "_SOURCE");
+        modDestination[slot] = state.getRawParameterValue (prefix + "_DEST");
+        modAmount[slot]      = state.getRawParameterValue (prefix + "_AMOUNT");
+        jassert (modSource[slot] != nullptr && modDestination[slot] != nullptr && modAmount[slot] != nullptr);
+    }
+
+    jassert (bpmSync != nullptr && syncRateChoice != nullptr && rate != nullptr && feedback != nullptr
+             && saturation != nullptr && drive != nullptr && width != nullptr && mix != nullptr && filterType != nullptr && cutoff != nullptr
+             && resonance != nullptr && modBypass != nullptr && modRate != nullptr && modDepth != nullptr
+             && modFeedback != nullptr && interpolation != nullptr && oversampling != nullptr
+             && oversamplingFilter != nullptr && tapCount != nullptr && tapSpacing != nullptr && tapSync != nullptr
+             && tapSyncRate != nullptr && tapDecay != nullptr && tapSpread != nullptr && parallelChannels != nullptr
+             && longDelay != nullptr && longRate != nullptr && envelopeAttack != nullptr && envelopeRelease != nullptr);
+}
+
+//==============================================================================
+// This creates new instances of the plugin..
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new FilteredDelayAudioProcessor();
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::updateDspSettings (Dsp<SampleType>& dsp)
+{
+    using filterType = juce::dsp::StateVariableTPTFilterType;
+
+    const auto mix = parameters.mix->load();
+    if (mix != appliedSettings.mix)
+        dsp.mixRamp.setTargetValue (appliedSettings.mix = mix);
+
+    const auto feedback = parameters.feedback->load();
+    if (feedback != appliedSettings.feedback)
+        dsp.delayEngine.setFeedback (appliedSettings.feedback = feedback);
+
+    const auto saturation = static_cast<int> (parameters.saturation->load());
+    const auto drive = parameters.drive->load();
+    if (saturation != appliedSettings.saturation || drive != appliedSettings.drive)
+    {
+        appliedSettings.saturation = saturation;
+        appliedSettings.drive = drive;
+        dsp.delayEngine.setSaturation (static_cast<SaturationShape> (saturation),
+                                       static_cast<SampleType> (juce::Decibels::decibelsToGain (drive)));
+    }
+
+    const auto type = static_cast<int> (parameters.filterType->load());
+    if (type != appliedSettings.filterType)
+    {
+        appliedSettings.filterType = type;
+
+        if (type == 0)
+            dsp.delayEngine.setFilterType(filterType::lowpass);
+
+        if (type == 1)
+            dsp.delayEngine.setFilterType(filterType::highpass);
+
+        if (type == 2)
+            dsp.delayEngine.setFilterType(filterType::bandpass);
+    }
+
+    // While the modulation matrix runs, it takes these to the filter itself.
+    const auto cutoff = parameters.cutoff->load();
+    if (cutoff != appliedSettings.cutoff)
+    {
+        appliedSettings.cutoff = cutoff;
+
+        if (! controlModulationRunning)
+            dsp.delayEngine.setCutoffFrequency (cutoff);
+    }
+
+    const auto resonance = parameters.resonance->load();
+    if (resonance != appliedSettings.resonance)
+    {
+        appliedSettings.resonance = resonance;
+
+        if (! controlModulationRunning)
+            dsp.delayEngine.setResonance (resonance);
+    }
+
+    const auto modBypass = parameters.modBypass->load() >= 0.5f ? 1 : 0;
+    if (modBypass != appliedSettings.modBypass)
+    {
+        appliedSettings.modBypass = modBypass;
+        dsp.delayEngine.setModulationEnabled (modBypass == 0);
+    }
+
+    const auto modRate = parameters.modRate->load();
+    if (modRate != appliedSettings.modRate)
+        dsp.delayEngine.setModulationRate (appliedSettings.modRate = modRate);
+
+    const auto modDepth = parameters.modDepth->load();
+    if (modDepth != appliedSettings.modDepth)
+        dsp.delayEngine.setModulationDepth (appliedSettings.modDepth = modDepth);
+
+    const auto modFeedback = parameters.modFeedback->load();
+    if (modFeedback != appliedSettings.modFeedback)
+        dsp.delayEngine.setModulationFeedback (appliedSettings.modFeedback = modFeedback);
+
+    const auto interpolation = static_cast<int> (parameters.interpolation->load());
+    if (interpolation != appliedSettings.interpolation)
+    {
+        appliedSettings.interpolation = interpolation;
+        dsp.delayEngine.setInterpolation (static_cast<DelayInterpolation> (interpolation));
+    }
+
+    const auto oversampling = static_cast<int> (parameters.oversampling->load());
+    const auto oversamplingFilter = static_cast<int> (parameters.oversamplingFilter->load());
+    if (oversampling != appliedSettings.oversampling || oversamplingFilter != appliedSettings.oversamplingFilter)
+    {
+        // Until the timer has built a new variant, the old one keeps running.
+        if (dsp.delayEngine.setOversampling (oversampling, oversamplingFilter == 1))
+        {
+            appliedSettings.oversampling = oversampling;
+            appliedSettings.oversamplingFilter = oversamplingFilter;
+        }
+    }
+
+    const auto parallelChannels = parameters.parallelChannels->load() >= 0.5f ? 1 : 0;
+    if (parallelChannels != appliedSettings.parallelChannels)
+    {
+        appliedSettings.parallelChannels = parallelChannels;
+        dsp.delayEngine.setParallelProcessingEnabled (parallelChannels == 1);
+    }
+}
+
+template <typename SampleType>
+float FilteredDelayAudioProcessor::updateDelayTimes (Dsp<SampleType>& dsp, int numSamples)
+{
+    tempoSync.updateFromPlayHead (getPlayHead());
+    tempoSync.setSubdivision (static_cast<int> (parameters.syncRateChoice->load()));
+    const float syncedDelayInSamples = tempoSync.getNextDelayInSamples (numSamples);
+    
+    const auto delayOffsetInSamples = static_cast<SampleType> (ambisonicLayout ? 0.0 : parameters.width->load() / 1000.0 * getSampleRate());
+    auto delayTimeInSamples = static_cast<SampleType> (parameters.rate->load() / 1000.0 * getSampleRate());
+
+    // Until the long history has been switched in, LONG_RATE is held to RATE's range.
+    const auto maxDelayMs = longDelayRunning ? maxLongDelayMs : maxRateMs;
+
+    if (parameters.longDelay->load() >= 0.5f)
+        delayTimeInSamples = static_cast<SampleType> (juce::jmin (parameters.longRate->load(), maxDelayMs) / 1000.0 * getSampleRate());
+    
+    // The synced time stays internal; writing it into RATE would flood the
+    // host with automation every block.
+    if (parameters.bpmSync->load() >= 0.5f)
+        delayTimeInSamples = static_cast<SampleType> (juce::jmin (syncedDelayInSamples, static_cast<float> (maxDelayMs / 1000.0 * getSampleRate())));
+    
+    effectiveDelayTimeMs.store (static_cast<float> (delayTimeInSamples / getSampleRate() * 1000.0));
+    
+    updateTaps (dsp);
+
+    // The engine glides to these per sample.
+    const auto delayR = delayTimeInSamples;
+    const auto delayL = delayR + delayOffsetInSamples;
+    dsp.delayEngine.setDelay(delayL, delayR);
+    
+    return static_cast<float> (delayL);
+}
+
+void FilteredDelayAudioProcessor::timerCallback()
+{
+    {
+        const juce::ScopedLock allocationLock (longDelayAllocationLock);
+
+        // PARALLEL_CHANNELS is switched on the audio thread; the worker threads
+        // follow it from here.
+        if (isUsingDoublePrecision())
+        {
+            updateLongDelayStorage (doubleDsp);
+            updateOversamplingStorage (doubleDsp);
+            doubleDsp.delayEngine.updateWorkers();
+        }
+        else
+        {
+            updateLongDelayStorage (floatDsp);
+            updateOversamplingStorage (floatDsp);
+            floatDsp.delayEngine.updateWorkers();
+        }
+    }
+
+    updateReportedTailLength();
+}
+
+void FilteredDelayAudioProcessor::updateReportedTailLength()
+{
+    const auto tailLength = getTailLengthSeconds();
+
+    // A knob being turned moves the tail a little at every poll, which isn't
+    // worth a host rescan each time.
+    const auto hasChanged = std::isinf (tailLength) || std::isinf (reportedTailLengthSeconds)
+                              ? tailLength != reportedTailLengthSeconds
+                              : std::abs (tailLength - reportedTailLengthSeconds) > reportedTailLengthSeconds * tailChangeTolerance;
+
+    if (! hasChanged)
+        return;
+
+    reportedTailLengthSeconds = tailLength;
+
+    // There's no flag for the tail alone; this is the one that makes hosts
+    // query the processor's properties again.
+    updateHostDisplay (ChangeDetails().withNonParameterStateChanged (true));
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::updateOversamplingStorage (Dsp<SampleType>& dsp)
+{
+    dsp.delayEngine.allocateOversampling (static_cast<int> (parameters.oversampling->load()),
+                                          static_cast<int> (parameters.oversamplingFilter->load()) == 1);
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::updateLongDelayStorage (Dsp<SampleType>& dsp)
+{
+    const auto storage = longDelayStorage.load (std::memory_order_acquire);
+
+    if (storage == LongDelayStorage::unused)
+    {
+        dsp.delayEngine.releaseLongDelay();
+        longDelayStorage.store (LongDelayStorage::released, std::memory_order_release);
+    }
+    else if (storage == LongDelayStorage::released && longDelayCanAllocate && parameters.longDelay->load() >= 0.5f)
+    {
+        // The same room for WIDTH and the matrix as the standard range has.
+        dsp.delayEngine.allocateLongDelay (maxLongDelayMs + maxWidthMs + maxRateModulationMs);
+        longDelayStorage.store (LongDelayStorage::allocated, std::memory_order_release);
+    }
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::updateLongDelay (Dsp<SampleType>& dsp) noexcept
+{
+    const auto wanted = parameters.longDelay->load() >= 0.5f;
+    const auto storage = longDelayStorage.load (std::memory_order_acquire);
+
+    if (wanted && storage == LongDelayStorage::allocated)
+    {
+        dsp.delayEngine.setLongDelayEnabled (true);
+        longDelayRunning = true;
+        longDelayStorage.store (LongDelayStorage::inUse, std::memory_order_release);
+    }
+    else if (! wanted && (storage == LongDelayStorage::allocated || storage == LongDelayStorage::inUse))
+    {
+        dsp.delayEngine.setLongDelayEnabled (false);
+        longDelayRunning = false;
+        longDelayStorage.store (LongDelayStorage::unused, std::memory_order_release);
+    }
+}
+
+void FilteredDelayAudioProcessor::updateModulationMatrix() noexcept
+{
+    // Polled every block like the taps; the matrix only stores what it's given.
+    for (size_t lfo = 0; lfo < (size_t) ModulationMatrix::numLfos; ++lfo)
+        modulationMatrix.setLfo ((int) lfo, parameters.lfoRate[lfo]->load(),
+                                 static_cast<ModulationMatrix::LfoShape> (static_cast<int> (parameters.lfoShape[lfo]->load())));
+
+    modulationMatrix.setEnvelope (parameters.envelopeAttack->load(), parameters.envelopeRelease->load());
+
+    for (size_t slot = 0; slot < (size_t) ModulationMatrix::numSlots; ++slot)
+        modulationMatrix.setSlot ((int) slot,
+                                  static_cast<ModulationMatrix::Source> (static_cast<int> (parameters.modSource[slot]->load())),
+                                  static_cast<ModulationMatrix::Destination> (static_cast<int> (parameters.modDestination[slot]->load())),
+                                  parameters.modAmount[slot]->load());
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::updateControlModulation (Dsp<SampleType>& dsp, const juce::dsp::AudioBlock<SampleType>& block, int numInputChannels)
+{
+    if (! modulationMatrix.isActive())
+    {
+        // Every route has faded out by now, so the filter is already at these.
+        if (controlModulationRunning)
+        {
+            controlModulationRunning = false;
+            dsp.delayEngine.setCutoffFrequency (static_cast<SampleType> (appliedSettings.cutoff));
+            dsp.delayEngine.setResonance (static_cast<SampleType> (appliedSettings.resonance));
+        }
+
+        return;
+    }
+
+    controlModulationRunning = true;
+
+    using Destination = ModulationMatrix::Destination;
+
+    const auto numIntervals = modulationMatrix.process (block, numInputChannels);
+    const auto* cutoffModulation = modulationMatrix.getValues (Destination::cutoff);
+    const auto* resonanceModulation = modulationMatrix.getValues (Destination::resonance);
+    const auto* rateModulation = modulationMatrix.getValues (Destination::rate);
+    const auto* widthModulation = modulationMatrix.getValues (Destination::width);
+
+    const auto samplesPerMs = static_cast<float> (getSampleRate() / 1000.0);
+    const auto width = parameters.width->load();
+
+    // Cutoff moves in octaves, the rest linearly. WIDTH stays within its own
+    // range, and like WIDTH itself only offsets the first channel of a pair.
+    for (size_t i = 0; i < (size_t) numIntervals; ++i)
+    {
+        controlCutoff[i] = juce::jlimit (20.0f, 20000.0f, appliedSettings.cutoff * std::exp2 (cutoffModulation[i] * maxCutoffModulationOctaves));
+        controlResonance[i] = juce::jlimit (0.0f, 2.0f, appliedSettings.resonance + resonanceModulation[i] * maxResonanceModulation);
+
+        const auto rateOffset = rateModulation[i] * maxRateModulationMs * samplesPerMs;
+        const auto widthOffset = ambisonicLayout ? 0.0f
+                                                 : (juce::jlimit (0.0f, maxWidthMs, width + widthModulation[i] * maxWidthMs) - width) * samplesPerMs;
+
+        controlDelayLeft[i] = rateOffset + widthOffset;
+        controlDelayRight[i] = rateOffset;
+    }
+
+    controlModulation.numIntervals = numIntervals;
+    dsp.delayEngine.setControlModulation (&controlModulation);
+}
+
+template <typename SampleType>
+void FilteredDelayAudioProcessor::updateTaps (Dsp<SampleType>& dsp)
+{
+    // Polled every block rather than flagged, since synced spacing follows the tempo.
+    const auto requestedTaps = static_cast<int> (parameters.tapCount->load());
+    auto spacingMs = parameters.tapSpacing->load();
+    const auto decay = parameters.tapDecay->load();
+    const auto spread = parameters.tapSpread->load();
+
+    if (parameters.tapSync->load() >= 0.5f)
+        spacingMs = static_cast<float> (TempoSync::getSubdivisionInBeats (static_cast<int> (parameters.tapSyncRate->load()))
+                                        * 60000.0 / tempoSync.getBpm());
+
+    // The ring grows and shrinks as the long history comes and goes.
+    const auto maxDelayInSamples = dsp.delayEngine.getMaxDelayInSamples();
+
+    if (requestedTaps == appliedSettings.tapCount && spacingMs == appliedSettings.tapSpacingMs
+        && decay == appliedSettings.tapDecay && spread == appliedSettings.tapSpread
+        && maxDelayInSamples == appliedSettings.tapMaxDelayInSamples)
+        return;
+
+    appliedSettings.tapCount = requestedTaps;
+    appliedSettings.tapSpacingMs = spacingMs;
+    appliedSettings.tapDecay = decay;
+    appliedSettings.tapSpread = spread;
+    appliedSettings.tapMaxDelayInSamples = maxDelayInSamples;
+
+    // Taps sit at whole multiples of the spacing, alternate sides and fade by
+    // TAP_DECAY each step. Those that would fall past the end of the ring are
+    // dropped rather than all piling up at its longest delay.
+    const auto spacingInSamples = static_cast<SampleType> (spacingMs / 1000.0f * static_cast<float> (getSampleRate()));
+    const auto numTaps = juce::jmin (requestedTaps, static_cast<int> (static_cast<SampleType> (maxDelayInSamples) / spacingInSamples));
+    auto gain = static_cast<SampleType> (1);
+
+    for (int tap = 0; tap < numTaps; ++tap)
+    {
+        dsp.delayEngine.setTap (tap, spacingInSamples * static_cast<SampleType> (tap + 1), gain,
+                                static_cast<SampleType> (tap % 2 == 0 ? -spread : spread));
+        gain *= static_cast<SampleType> (decay);
+    }
+
+    dsp.delayEngine.setNumTaps (numTaps);
+    longestTapMs.store (spacingMs * static_cast<float> (numTaps));
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout FilteredDelayAudioProcessor::createParameters()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout params;
+    
+    using Range = juce::NormalisableRange<float>;
+    using pID = juce::ParameterID;
+    
+    // Matches TempoSync's subdivisions table.
+    const juce::StringArray subdivisionNames { "16th", "16th Triplet", "16th Dotted",
+                                               "8th", "8th Triplet", "8th Dotted", "Quarter", "Quarter Triplet", "Quarter Dotted",
+                                               "Half", "Half Triplet", "Half Dotted", "Whole" };
+    
+    params.add (std::make_unique<juce::AudioParameterBool>  (pID {"BPM_SYNC", 1}, "Bpm Sync", true));
+    params.add (std::make_unique<juce::AudioParameterChoice>(pID {"SYNC_RATE_CHOICE", 1}, "Sync Rate Choice", subdivisionNames, 3));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"RATE", 1}, "Rate", Range {1.0f, maxRateMs, 1.0}, 0, "ms"));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"FEEDBACK", 1}, "Feedback", Range {0.0f, 1.0f, 0.01f}, 0.25f, "%"));
+    params.add (std::make_unique<juce::AudioParameterChoice>(pID {"SATURATION", 1}, "Saturation", juce::StringArray("Off", "Tape", "Soft", "Hard"), 0));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"DRIVE", 1}, "Drive", Range {0.0f, 24.0f, 0.1f}, 6.0f, "dB"));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"WIDTH", 1}, "Width", Range {0.0f, maxWidthMs, 0.1f}, 0.0f, "ms"));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"MIX", 1}, "Mix", Range { 0.0f, 1.0f, 0.01f }, 0.0f, "%"));
+    params.add (std::make_unique<juce::AudioParameterChoice>(pID {"FILTER_TYPE", 1}, "Filter Type", juce::StringArray("Lowpass", "Highpass", "Bandpass"), 0));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"CUTOFF", 1}, "Cutoff", Range {20.0f, 20000.0f, 1.0f, 0.2f}, 1000.f, "Hz"));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"RESONANCE", 1}, "Resonance", Range {0.0f, 2.0f, 0.1f}, 0.707f));
+    params.add (std::make_unique<juce::AudioParameterBool>  (pID {"MOD_BP", 1}, "Mod Bypass", true));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"MOD_RATE", 1}, "Mod Rate", Range{0.05f, 5.0f, 0.01f}, 1.0f, "Hz"));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"MOD_DEPTH", 1}, "Mod Depth", Range{0.0f, 1.0f, 0.01f}, 0.15f));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"MOD_FB", 1}, "Mod Feedback", Range{0.0f, 0.5f, 0.01f}, 0.0f));
+    params.add (std::make_unique<juce::AudioParameterChoice>(pID {"INTERPOLATION", 1}, "Interpolation", juce::StringArray("Linear", "Lagrange", "Thiran", "Sinc"), 0));
+    params.add (std::make_unique<juce::AudioParameterChoice>(pID {"OVERSAMPLING", 1}, "Oversampling", juce::StringArray("Off", "2x", "4x"), 0));
+    params.add (std::make_unique<juce::AudioParameterChoice>(pID {"OVERSAMPLING_FILTER", 1}, "Oversampling Filter", juce::StringArray("IIR", "FIR"), 0));
+    params.add (std::make_unique<juce::AudioParameterInt>   (pID {"TAP_COUNT", 1}, "Tap Count", 0, DelayTaps<float>::maxTaps, 0));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"TAP_SPACING", 1}, "Tap Spacing", Range {10.0f, 250.0f, 1.0f}, 125.0f, "ms"));
+    params.add (std::make_unique<juce::AudioParameterBool>  (pID {"TAP_SYNC", 1}, "Tap Sync", false));
+    params.add (std::make_unique<juce::AudioParameterChoice>(pID {"TAP_SYNC_RATE", 1}, "Tap Sync Rate", subdivisionNames, 0));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"TAP_DECAY", 1}, "Tap Decay", Range {0.0f, 1.0f, 0.01f}, 0.7f));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"TAP_SPREAD", 1}, "Tap Spread", Range {0.0f, 1.0f, 0.01f}, 0.5f));
+    params.add (std::make_unique<juce::AudioParameterBool>  (pID {"LONG_DELAY", 1}, "Long Delay", false));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"LONG_RATE", 1}, "Long Rate", Range {100.0f, maxLongDelayMs, 1.0f, 0.4f}, 5000.0f, "ms"));
+    // Off by default: a block still waits for any pair a worker has started.
+    params.add (std::make_unique<juce::AudioParameterBool>  (pID {"PARALLEL_CHANNELS", 1}, "Parallel Channels", false,
+                                                             juce::AudioParameterBoolAttributes().withAutomatable (false)));
+    
+    // Modulation matrix; ModulationMatrix's enums follow these choice lists.
+    const juce::StringArray lfoShapeNames { "Sine", "Triangle", "Saw", "Square" };
+    
+    for (int lfo = 1; lfo <= ModulationMatrix::numLfos; ++lfo)
+    {
+        const auto prefix = "LFO" + juce::String (lfo);
+        params.add (std::make_unique<juce::AudioParameterFloat> (pID {prefix + "_RATE", 1}, "LFO " + juce::String (lfo) + " Rate", Range {0.01f, 20.0f, 0.01f, 0.3f}, lfo == 1 ? 0.25f : 2.0f, "Hz"));
+        params.add (std::make_unique<juce::AudioParameterChoice>(pID {prefix + "_SHAPE", 1}, "LFO " + juce::String (lfo) + " Shape", lfoShapeNames, 0));
+    }
+    
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"ENV_ATTACK", 1}, "Envelope Attack", Range {0.1f, 200.0f, 0.1f, 0.4f}, 10.0f, "ms"));
+    params.add (std::make_unique<juce::AudioParameterFloat> (pID {"ENV_RELEASE", 1}, "Envelope Release", Range {5.0f, 2000.0f, 1.0f, 0.4f}, 200.0f, "ms"));
+    
+    for (int slot = 1; slot <= ModulationMatrix::numSlots; ++slot)
+    {
+        const auto prefix = "MOD" + juce::String (slot);
+        params.add (std::make_unique<juce::AudioParameterChoice>(pID {prefix + "_SOURCE", 1}, "Mod " + juce::String (slot) + " Source", juce::StringArray ("Off", "LFO 1", "LFO 2", "Envelope"), 0));
+        params.add (std::make_unique<juce::AudioParameterChoice>(pID {prefix + "_DEST", 1}, "Mod " + juce::String (slot) + " Destination", juce::StringArray ("Cutoff", "Resonance", "Rate", "Width"), 0));
+        params.add (std::make_unique<juce::AudioParameterFloat> (pID {prefix + "_AMOUNT", 1}, "Mod " + juce::String (slot) + " Amount", Range {-1.0f, 1.0f, 0.01f}, 0.0f));
+    }
+    
+    return params;
+}
+
+juce::Array<juce::RangedAudioParameter*> FilteredDelayAudioProcessor::findPresetParameters (const juce::Array<juce::AudioProcessorParameter*>& parameters)
+{
+    juce::Array<juce::RangedAudioParameter*> found;
+
+    for (auto* parameter : parameters)
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter))
+            if (ranged->isAutomatable())
+                found.add (ranged);
+
+    return found;
+}
+
+PresetBank FilteredDelayAudioProcessor::createFactoryPresets (const juce::Array<juce::RangedAudioParameter*>& parameters)
+{
+    juce::StringArray parameterIDs;
+    std::vector<float> defaultValues;
+
+    for (auto* parameter : parameters)
+    {
+        parameterIDs.add (parameter->getParameterID());
+        defaultValues.push_back (parameter->convertFrom0to1 (parameter->getDefaultValue()));
+    }
+
+    PresetBank bank (parameterIDs, defaultValues);
+
+    // Choice parameters take their index; SYNC_RATE_CHOICE 3 is an 8th, 5 a dotted 8th, 6 a quarter.
+    bank.addPreset ("Init", {});
+    bank.addPreset ("Slapback",        { { "BPM_SYNC", 0.0f }, { "RATE", 110.0f }, { "FEEDBACK", 0.1f }, { "MIX", 0.35f },
+                                         { "CUTOFF", 4500.0f } });
+    bank.addPreset ("Dotted Eighth",   { { "SYNC_RATE_CHOICE", 5.0f }, { "FEEDBACK", 0.45f }, { "WIDTH", 1.5f }, { "MIX", 0.3f },
+                                         { "CUTOFF", 3000.0f } });
+    bank.addPreset ("Dark Dub",        { { "SYNC_RATE_CHOICE", 6.0f }, { "FEEDBACK", 0.75f }, { "MIX", 0.4f },
+                                         { "CUTOFF", 900.0f }, { "RESONANCE", 1.2f } });
+    bank.addPreset ("Telephone",       { { "FILTER_TYPE", 2.0f }, { "CUTOFF", 1500.0f }, { "RESONANCE", 1.5f },
+                                         { "FEEDBACK", 0.55f }, { "MIX", 0.35f } });
+    bank.addPreset ("Thin Repeats",    { { "FILTER_TYPE", 1.0f }, { "CUTOFF", 800.0f }, { "FEEDBACK", 0.6f }, { "WIDTH", 3.0f },
+                                         { "MIX", 0.3f } });
+    bank.addPreset ("Tape Wobble",     { { "MOD_BP", 0.0f }, { "MOD_RATE", 0.6f }, { "MOD_DEPTH", 0.3f }, { "MOD_FB", 0.1f },
+                                         { "INTERPOLATION", 1.0f }, { "FEEDBACK", 0.4f }, { "MIX", 0.3f }, { "CUTOFF", 2500.0f } });
+    bank.addPreset ("Multitap Rhythm", { { "TAP_COUNT", 6.0f }, { "TAP_SYNC", 1.0f }, { "TAP_SYNC_RATE", 3.0f }, { "TAP_DECAY", 0.75f },
+                                         { "TAP_SPREAD", 0.8f }, { "FEEDBACK", 0.2f }, { "MIX", 0.4f } });
+    bank.addPreset ("Filter Sweep",    { { "SYNC_RATE_CHOICE", 6.0f }, { "FEEDBACK", 0.6f }, { "MIX", 0.35f }, { "CUTOFF", 1200.0f },
+                                         { "RESONANCE", 1.4f }, { "LFO1_RATE", 0.2f }, { "MOD1_SOURCE", 1.0f }, { "MOD1_AMOUNT", 0.5f } });
+    bank.addPreset ("Envelope Wah",    { { "FILTER_TYPE", 2.0f }, { "CUTOFF", 600.0f }, { "RESONANCE", 1.6f }, { "FEEDBACK", 0.45f },
+                                         { "MIX", 0.4f }, { "ENV_RELEASE", 150.0f }, { "MOD1_SOURCE", 3.0f }, { "MOD1_AMOUNT", 0.6f } });
+    bank.addPreset ("Saturated Dub",   { { "SYNC_RATE_CHOICE", 5.0f }, { "FEEDBACK", 0.95f }, { "RESONANCE", 1.4f }, { "MIX", 0.4f },
+                                         { "CUTOFF", 1100.0f }, { "SATURATION", 1.0f }, { "DRIVE", 12.0f } });
+    return bank;
+}
+
@@ -1,108 +1,332 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-
-
-//==============================================================================
-/**
-*/
-class FilteredDelayAudioProcessor  : public juce::AudioProcessor,
-                                     public juce::AudioProcessorValueTreeState::Listener
-                                     
-{
-public:
-    //==============================================================================
-    FilteredDelayAudioProcessor();
-    ~FilteredDelayAudioProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const juce::String getProgramName (int index) override;
-    void changeProgramName (int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (juce::MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-//   
-
-    
-
-private:
-    juce::AudioProcessorValueTreeState treeState;
-
-
-// Delay
-    static constexpr auto maxDelaySamples = 192000;
-    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> delayL {maxDelaySamples};
-    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> delayR {maxDelaySamples};
-
-    
-    float delayTimeInSamples {0};
-    juce::SmoothedValue<float, juce::Interpolators::WindowedSinc> delayTimeSmoothedValue {0};
-
-    float delayOffsetInSamples {0.0f};
-    juce::SmoothedValue<float, juce::Interpolators::WindowedSinc> delayOffsetSmoothedValue {0};
-    std::array<float, 2> lastDelayOutputL;
-    std::array<float, 2> lastDelayOutputR;
-    std::array<juce::LinearSmoothedValue<float>, 2> delayFeedbackVolume;
-    
-    
-    juce::AudioPlayHead* playHead;
-    juce::AudioPlayHead::CurrentPositionInfo cpi;
-    double bpm{0};
-
-    const std::array<float, 13> subdivisions{ 0.25f, (0.5f/3.0f), 0.375f, 0.5f, (1.0f/3.0f), 0.75f, 1.0f, (2.0f/3.0f), 1.5f, 2.0f, (4.0f/3.0f),3.0f, 4.0f };
-    
-// Mixer
-    juce::dsp::DryWetMixer<float> mixer;
-
-
-// Filter
-    
-    juce::dsp::StateVariableTPTFilter<float> filter;
-    
-// Modulation
-    
-    juce::dsp::Chorus<float> mod;
-
-
-// ValueTree
-    
-    void parameterChanged (const juce::String& parameterID, float newValue) override;
-    juce::AudioProcessorValueTreeState::ParameterLayout createParameters();
-
-    //==============================================================================
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FilteredDelayAudioProcessor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "AnalysisFeed.h"
+#include "ModulationMatrix.h"
+#include "MultichannelDelay.h"
+#include "ParameterRamp.h"
+#include "PresetBank.h"
+#include "ProcessProfiler.h"
+#include "TempoSync.h"
+
+
+//==============================================================================
+/**
+*/
+class FilteredDelayAudioProcessor  : public juce::AudioProcessor,
+                                     private juce::Timer
+
+{
+public:
+    //==============================================================================
+    FilteredDelayAudioProcessor();
+    ~FilteredDelayAudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const juce::String getProgramName (int index) override;
+    void changeProgramName (int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+    //==============================================================================
+    /** The delay time currently in use, in ms, whether free-running or synced. */
+    float getEffectiveDelayTimeMs() const noexcept;
+
+    /** Stage timings; only filled in when built with FILTERED_DELAY_PROFILING. */
+    ProcessProfiler& getProfiler() noexcept                 { return profiler; }
+
+    /** Wet-signal peaks for the editor's meter. */
+    AnalysisFeed& getAnalysisFeed() noexcept                { return analysisFeed; }
+
+    /** The delay memory currently allocated, long delay history included. */
+    size_t getDelayMemoryUsageInBytes() const noexcept;
+
+    /** Replaces the program list with a bank in PresetBank's binary form.
+        Returns false, keeping the current programs, if the data isn't one.
+    */
+    bool loadPresetBank (const void* data, size_t sizeInBytes);
+
+    /** The current program list in PresetBank's binary form. */
+    juce::MemoryBlock getPresetBankData() const;
+//   
+
+    
+
+private:
+    juce::AudioProcessorValueTreeState treeState;
+
+// Parameters
+    // Resolved once at construction, so the audio thread never looks up by ID.
+    struct Parameters
+    {
+        explicit Parameters (juce::AudioProcessorValueTreeState& state);
+
+        std::atomic<float>* bpmSync;
+        std::atomic<float>* syncRateChoice;
+        std::atomic<float>* rate;
+        std::atomic<float>* feedback;
+        std::atomic<float>* saturation;
+        std::atomic<float>* drive;
+        std::atomic<float>* width;
+        std::atomic<float>* mix;
+        std::atomic<float>* filterType;
+        std::atomic<float>* cutoff;
+        std::atomic<float>* resonance;
+        std::atomic<float>* modBypass;
+        std::atomic<float>* modRate;
+        std::atomic<float>* modDepth;
+        std::atomic<float>* modFeedback;
+        std::atomic<float>* interpolation;
+        std::atomic<float>* oversampling;
+        std::atomic<float>* oversamplingFilter;
+        std::atomic<float>* tapCount;
+        std::atomic<float>* tapSpacing;
+        std::atomic<float>* tapSync;
+        std::atomic<float>* tapSyncRate;
+        std::atomic<float>* tapDecay;
+        std::atomic<float>* tapSpread;
+        std::atomic<float>* parallelChannels;
+        std::atomic<float>* longDelay;
+        std::atomic<float>* longRate;
+
+        std::array<std::atomic<float>*, (size_t) ModulationMatrix::numLfos> lfoRate, lfoShape;
+        std::atomic<float>* envelopeAttack;
+        std::atomic<float>* envelopeRelease;
+        std::array<std::atomic<float>*, (size_t) ModulationMatrix::numSlots> modSource, modDestination, modAmount;
+    };
+
+    Parameters parameters { treeState };
+
+    // The values last pushed into the DSP objects; audio thread and prepareToPlay only.
+    struct DspSettings
+    {
+        float mix = -1.0f;
+        float feedback = -1.0f;
+        int saturation = -1;
+        float drive = -1.0f;
+        int filterType = -1;
+        float cutoff = -1.0f;
+        float resonance = -1.0f;
+        int modBypass = -1;
+        float modRate = -1.0f;
+        float modDepth = -1.0f;
+        float modFeedback = -1.0f;
+        int interpolation = -1;
+        int oversampling = -1;
+        int oversamplingFilter = -1;
+        int tapCount = -1;
+        float tapSpacingMs = -1.0f;
+        float tapDecay = -1.0f;
+        float tapSpread = -1.0f;
+        int tapMaxDelayInSamples = -1;
+        int parallelChannels = -1;
+    };
+
+    DspSettings appliedSettings;
+
+// Programs
+    // Guards programWritesInProgress; the audio thread only ever tries it.
+    juce::SpinLock parameterWriteLock;
+    int programWritesInProgress = 0;
+    std::atomic<bool> crossfadePending { false };
+
+    // Programs only cover the automatable parameters.
+    static juce::Array<juce::RangedAudioParameter*> findPresetParameters (const juce::Array<juce::AudioProcessorParameter*>& parameters);
+    static PresetBank createFactoryPresets (const juce::Array<juce::RangedAudioParameter*>& parameters);
+
+    juce::Array<juce::RangedAudioParameter*> presetParameters { findPresetParameters (getParameters()) };
+    PresetBank presetBank { createFactoryPresets (presetParameters) };
+    int currentProgram = 0;
+
+    /** Writes a set of parameter values as one change, crossfaded in on the audio thread. */
+    void applyParameterValues (const juce::Array<juce::RangedAudioParameter*>& targets, const std::vector<float>& values);
+
+
+// DSP
+    static constexpr float maxRateMs = 2000.0f;
+    static constexpr float maxWidthMs = 5.0f;
+    static constexpr double mixRampSeconds = 0.05;
+
+    // The audio path for one sample type; only the host's precision is prepared.
+    template <typename SampleType>
+    struct Dsp
+    {
+        MultichannelDelay<SampleType> delayEngine;
+        ParameterRamp<SampleType> mixRamp;
+        juce::AudioBuffer<SampleType> dryBuffer;
+    };
+
+    Dsp<float> floatDsp;
+    Dsp<double> doubleDsp;
+
+    template <typename SampleType>
+    Dsp<SampleType>& getDsp() noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleDsp;
+        else
+            return floatDsp;
+    }
+
+    template <typename SampleType>
+    void prepareDsp (Dsp<SampleType>& dsp, const juce::dsp::ProcessSpec& spec);
+
+    template <typename SampleType>
+    static void releaseDsp (Dsp<SampleType>& dsp);
+
+    template <typename SampleType>
+    void processSamples (juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages);
+
+    /** Processes at most the prepared block size. */
+    template <typename SampleType>
+    void processSection (const juce::dsp::AudioBlock<SampleType>& block);
+
+    template <typename SampleType>
+    void updateDspSettings (Dsp<SampleType>& dsp);
+    
+// Channels
+    // Enough for 7.1.4 and for ambisonics up to seventh order.
+    static constexpr int maxNumChannels = 64;
+    bool ambisonicLayout = false;
+    
+    TempoSync tempoSync;
+    std::atomic<float> effectiveDelayTimeMs { 0.0f };
+    
+    /** Follows tempo, RATE and WIDTH, updates the taps and sets the engine's
+        delays; returns the longer of the two delays in samples.
+    */
+    template <typename SampleType>
+    float updateDelayTimes (Dsp<SampleType>& dsp, int numSamples);
+    
+// Long delay
+    // The long history is allocated by the message thread and switched by the audio thread.
+    static constexpr float maxLongDelayMs = 30000.0f;
+    static constexpr int longDelayPollMs = 100;
+
+    enum class LongDelayStorage
+    {
+        released,       // message thread: allocates if LONG_DELAY is on
+        allocated,      // audio thread: switches it in, or straight out again
+        inUse,          // audio thread: switches it out once LONG_DELAY is off
+        unused          // message thread: frees it
+    };
+
+    std::atomic<LongDelayStorage> longDelayStorage { LongDelayStorage::released };
+    juce::CriticalSection longDelayAllocationLock;
+    bool longDelayCanAllocate = false;     // between prepareToPlay and releaseResources
+    bool longDelayRunning = false;
+
+    void timerCallback() override;
+
+    /** Message thread: allocates or frees the long history as LONG_DELAY asks. */
+    template <typename SampleType>
+    void updateLongDelayStorage (Dsp<SampleType>& dsp);
+
+    /** Message thread: builds the oversampling filters OVERSAMPLING asks for. */
+    template <typename SampleType>
+    void updateOversamplingStorage (Dsp<SampleType>& dsp);
+
+    /** Audio thread: switches the long history in or out. */
+    template <typename SampleType>
+    void updateLongDelay (Dsp<SampleType>& dsp) noexcept;
+
+// Taps
+    std::atomic<float> longestTapMs { 0.0f };
+    
+    template <typename SampleType>
+    void updateTaps (Dsp<SampleType>& dsp);
+    
+// Modulation matrix
+    // Full-scale modulation of each destination.
+    static constexpr float maxCutoffModulationOctaves = 4.0f;
+    static constexpr float maxResonanceModulation = 1.0f;
+    static constexpr float maxRateModulationMs = 20.0f;
+
+    ModulationMatrix modulationMatrix;
+    bool controlModulationRunning = false;
+
+    // One value per control interval, rebuilt every block while the matrix runs.
+    std::vector<float> controlCutoff, controlResonance, controlDelayLeft, controlDelayRight;
+    ControlModulation controlModulation;
+
+    void updateModulationMatrix() noexcept;
+
+    /** Runs the matrix over the block's input and hands the engine its targets,
+        or lets the filter go back to CUTOFF and RESONANCE once it stops.
+    */
+    template <typename SampleType>
+    void updateControlModulation (Dsp<SampleType>& dsp, const juce::dsp::AudioBlock<SampleType>& block, int numInputChannels);
+    
+// Silence
+    static constexpr float silenceThresholdGain = 1.0e-5f;   // -100 dB
+    static constexpr double tailThresholdGain = 1.0e-4;      // -80 dB
+    static constexpr double tailChangeTolerance = 0.05;      // relative change reported to the host
+    bool idle = false;
+    int silentSamples = 0;
+    float longestDelayInSamples = 0.0f;
+    
+    template <typename SampleType>
+    static bool isSilent (const juce::dsp::AudioBlock<SampleType>& block, int numChannels) noexcept;
+    static double calculateTailLengthSeconds (float delayTimeMs, float feedback, float resonance, float modFeedback);
+
+    // The tail the host was last told about; the timer reports changes.
+    double reportedTailLengthSeconds = 0.0;
+    void updateReportedTailLength();
+    
+// Mixer
+    template <typename SampleType>
+    static void mixDryAndWet (Dsp<SampleType>& dsp, const juce::dsp::AudioBlock<SampleType>& block, int numChannels) noexcept;
+
+
+// Profiling
+    ProcessProfiler profiler;
+
+
+// Analysis
+    AnalysisFeed analysisFeed;
+
+
+// ValueTree
+    
+    juce::AudioProcessorValueTreeState::ParameterLayout createParameters();
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FilteredDelayAudioProcessor)
+};
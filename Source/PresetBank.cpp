@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+
+    A bank of programs held as parameter snapshots, with a compact binary form.
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+//==============================================================================
+PresetBank::PresetBank (juce::StringArray ids, std::vector<float> defaults)
+    : parameterIDs (std::move (ids)),
+      defaultValues (std::move (defaults))
+{
+    jassert ((size_t) parameterIDs.size() == defaultValues.size());
+}
+
+void PresetBank::setPresetName (int index, const juce::String& newName)
+{
+    if (juce::isPositiveAndBelow (index, getNumPresets()))
+        presets[(size_t) index].name = newName;
+}
+
+void PresetBank::addPreset (const juce::String& name, std::initializer_list<std::pair<const char*, float>> changedValues)
+{
+    Preset preset { name, defaultValues };
+
+    for (const auto& [parameterID, value] : changedValues)
+    {
+        const auto index = parameterIDs.indexOf (parameterID);
+        jassert (index >= 0);
+
+        if (index >= 0)
+            preset.values[(size_t) index] = value;
+    }
+
+    presets.push_back (std::move (preset));
+}
+
+//==============================================================================
+juce::MemoryBlock PresetBank::toBinary() const
+{
+    juce::MemoryOutputStream stream;
+
+    stream.writeInt ((int) magic);
+    stream.writeShort ((short) formatVersion);
+
+    stream.writeCompressedInt (parameterIDs.size());
+
+    for (const auto& parameterID : parameterIDs)
+        stream.writeString (parameterID);
+
+    stream.writeCompressedInt (getNumPresets());
+
+    for (const auto& preset : presets)
+    {
+        stream.writeString (preset.name);
+
+        for (auto value : preset.values)
+            stream.writeFloat (value);
+    }
+
+    return stream.getMemoryBlock();
+}
+
+bool PresetBank::loadFromBinary (const void* data, size_t sizeInBytes)
+{
+    juce::MemoryInputStream stream (data, sizeInBytes, false);
+
+    if (sizeInBytes < 6 || (juce::uint32) stream.readInt() != magic)
+        return false;
+
+    const auto version = (int) stream.readShort();
+
+    if (version < 1 || version > formatVersion)
+        return false;
+
+    // Where each stored parameter goes in this build's snapshots, or -1.
+    const auto numStoredParameters = stream.readCompressedInt();
+
+    if (numStoredParameters < 0 || numStoredParameters > stream.getNumBytesRemaining())
+        return false;
+
+    std::vector<int> destinations;
+    destinations.reserve ((size_t) numStoredParameters);
+
+    for (int i = 0; i < numStoredParameters; ++i)
+        destinations.push_back (parameterIDs.indexOf (stream.readString()));
+
+    const auto numStoredPresets = stream.readCompressedInt();
+    const auto bytesPerPreset = 1 + (juce::int64) numStoredParameters * (juce::int64) sizeof (float);
+
+    if (numStoredPresets < 0 || numStoredPresets * bytesPerPreset > stream.getNumBytesRemaining())
+        return false;
+
+    std::vector<Preset> loaded;
+    loaded.reserve ((size_t) numStoredPresets);
+
+    for (int i = 0; i < numStoredPresets; ++i)
+    {
+        Preset preset { stream.readString(), defaultValues };
+
+        for (auto destination : destinations)
+        {
+            const auto value = stream.readFloat();
+
+            if (destination >= 0)
+                preset.values[(size_t) destination] = value;
+        }
+
+        loaded.push_back (std::move (preset));
+    }
+
+    if (loaded.empty())
+        return false;
+
+    presets = std::move (loaded);
+    return true;
+}
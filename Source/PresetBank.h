@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+
+    A bank of programs held as parameter snapshots, with a compact binary form.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    The plugin's programs, each one a plain value for every parameter.
+
+    Presets are parsed into snapshots once, when a bank is built or loaded, so
+    switching program is only a matter of writing the stored values back; no
+    XML or ValueTree is involved.
+
+    The binary form is little-endian throughout:
+
+        uint32  magic ("FDPB")
+        uint16  format version
+        varint  number of parameters, then each parameter ID as a
+                null-terminated UTF-8 string
+        varint  number of presets, then for each one its name as a
+                null-terminated UTF-8 string followed by one float32 per
+                parameter, in the order of the ID table
+
+    Parameters are matched by ID when a bank is loaded, so banks written
+    before a parameter was added still load: the new parameter keeps its
+    default, and IDs that no longer exist are skipped.
+*/
+class PresetBank
+{
+public:
+    struct Preset
+    {
+        juce::String name;
+        std::vector<float> values;    // plain values, in getParameterIDs() order
+    };
+
+    //==============================================================================
+    /** Sets the parameters that snapshots cover and the values a preset starts from. */
+    PresetBank (juce::StringArray parameterIDs, std::vector<float> defaultValues);
+
+    const juce::StringArray& getParameterIDs() const noexcept     { return parameterIDs; }
+
+    int getNumPresets() const noexcept                            { return (int) presets.size(); }
+    const Preset& getPreset (int index) const noexcept            { return presets[(size_t) index]; }
+
+    void setPresetName (int index, const juce::String& newName);
+
+    /** Adds a preset that differs from the defaults only in the values given. */
+    void addPreset (const juce::String& name, std::initializer_list<std::pair<const char*, float>> changedValues);
+
+    //==============================================================================
+    static constexpr juce::uint32 magic = 0x42504446;    // "FDPB"
+    static constexpr int formatVersion = 1;
+
+    juce::MemoryBlock toBinary() const;
+
+    /** Replaces every preset with those in a binary bank. Returns false and
+        leaves the bank as it was if the data isn't a bank this version reads.
+    */
+    bool loadFromBinary (const void* data, size_t sizeInBytes);
+
+private:
+    //==============================================================================
+    juce::StringArray parameterIDs;
+    std::vector<float> defaultValues;
+    std::vector<Preset> presets;
+
+    JUCE_LEAK_DETECTOR (PresetBank)
+};
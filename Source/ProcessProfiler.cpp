@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    ProcessProfiler.cpp
+
+  ==============================================================================
+*/
+
+#include "ProcessProfiler.h"
+
+//==============================================================================
+void ProcessProfiler::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    samplesInWindow = 0;
+    windowStartCycles = readCycleCounter();
+    windowStartTicks = juce::Time::getHighResolutionTicks();
+
+    for (auto& accumulator : accumulators)
+    {
+        accumulator.minimum.store (std::numeric_limits<juce::uint64>::max(), std::memory_order_relaxed);
+        accumulator.maximum.store (0, std::memory_order_relaxed);
+        accumulator.total.store (0, std::memory_order_relaxed);
+        accumulator.count.store (0, std::memory_order_relaxed);
+    }
+}
+
+void ProcessProfiler::endBlock (int numSamples) noexcept
+{
+    samplesInWindow += numSamples;
+
+    if (samplesInWindow >= snapshotIntervalSeconds * sampleRate)
+        publishSnapshot();
+}
+
+void ProcessProfiler::publishSnapshot() noexcept
+{
+    const auto cycles = readCycleCounter();
+    const auto ticks = juce::Time::getHighResolutionTicks();
+    const auto elapsedSeconds = juce::Time::highResolutionTicksToSeconds (ticks - windowStartTicks);
+
+    Snapshot snapshot;
+    snapshot.cyclesPerSecond = elapsedSeconds > 0.0 ? (double) (cycles - windowStartCycles) / elapsedSeconds : 0.0;
+
+    for (size_t i = 0; i < accumulators.size(); ++i)
+    {
+        auto& accumulator = accumulators[i];
+        const auto count = accumulator.count.load (std::memory_order_relaxed);
+
+        if (count > 0)
+        {
+            snapshot.stages[i].minimumCycles = (double) accumulator.minimum.load (std::memory_order_relaxed);
+            snapshot.stages[i].maximumCycles = (double) accumulator.maximum.load (std::memory_order_relaxed);
+            snapshot.stages[i].meanCycles = (double) accumulator.total.load (std::memory_order_relaxed) / count;
+        }
+
+        if (i == (size_t) Stage::block)
+        {
+            snapshot.numBlocks = count;
+
+            if (snapshot.cyclesPerSecond > 0.0)
+                snapshot.cpuLoad = (double) accumulator.total.load (std::memory_order_relaxed) / snapshot.cyclesPerSecond
+                                 / (samplesInWindow / sampleRate);
+        }
+
+        accumulator.minimum.store (std::numeric_limits<juce::uint64>::max(), std::memory_order_relaxed);
+        accumulator.maximum.store (0, std::memory_order_relaxed);
+        accumulator.total.store (0, std::memory_order_relaxed);
+        accumulator.count.store (0, std::memory_order_relaxed);
+    }
+
+    latestCpuLoad.store (snapshot.cpuLoad, std::memory_order_relaxed);
+
+    // With nobody reading, the FIFO fills up and newer snapshots are dropped.
+    const auto scope = fifo.write (1);
+
+    if (scope.blockSize1 > 0)
+        snapshots[(size_t) scope.startIndex1] = snapshot;
+
+    samplesInWindow = 0;
+    windowStartCycles = cycles;
+    windowStartTicks = ticks;
+}
+
+//==============================================================================
+bool ProcessProfiler::popSnapshot (Snapshot& snapshot) noexcept
+{
+    const auto scope = fifo.read (1);
+
+    if (scope.blockSize1 == 0)
+        return false;
+
+    snapshot = snapshots[(size_t) scope.startIndex1];
+    return true;
+}
+
+void ProcessProfiler::writeSnapshots (juce::OutputStream& stream, const juce::String& prefix)
+{
+    Snapshot snapshot;
+
+    while (popSnapshot (snapshot))
+    {
+        auto row = prefix + juce::String (snapshot.cpuLoad, 6) + ',' + juce::String (snapshot.numBlocks);
+
+        for (const auto& stage : snapshot.stages)
+            row << ',' << juce::String (stage.minimumCycles, 0)
+                << ',' << juce::String (stage.meanCycles, 1)
+                << ',' << juce::String (stage.maximumCycles, 0);
+
+        stream << row << juce::newLine;
+    }
+}
+
+juce::String ProcessProfiler::getCsvHeader()
+{
+    juce::String header ("cpu_load,num_blocks");
+
+    for (int i = 0; i < numStages; ++i)
+    {
+        const juce::String name (getStageName ((Stage) i));
+        header << ',' << name << "_min_cycles," << name << "_mean_cycles," << name << "_max_cycles";
+    }
+
+    return header;
+}
+
+const char* ProcessProfiler::getStageName (Stage stage) noexcept
+{
+    switch (stage)
+    {
+        case Stage::block:      return "block";
+        case Stage::parameters: return "parameters";
+        case Stage::delay:      return "delay";
+        case Stage::mixer:      return "mixer";
+        case Stage::numStages:  break;
+    }
+
+    return "";
+}
@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+    ProcessProfiler.h
+
+    Per-stage cycle counts for processBlock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL && (JUCE_MSVC || JUCE_CLANG || JUCE_GCC)
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+// Build with FILTERED_DELAY_PROFILING=1 to time the processBlock stages. When
+// it's off, the FILTERED_DELAY_PROFILE_ macros compile to nothing.
+#ifndef FILTERED_DELAY_PROFILING
+ #define FILTERED_DELAY_PROFILING 0
+#endif
+
+//==============================================================================
+/**
+    Times the stages of processBlock with the CPU's cycle counter.
+
+    Only the audio thread writes. Each stage keeps its minimum, maximum and
+    total in relaxed atomics, and every snapshotIntervalSeconds of audio
+    those are turned into a Snapshot, pushed through a lock-free FIFO and
+    cleared. Anything else - the editor's CPU meter, a headless host
+    writing a report - pops the snapshots from a single reader thread.
+
+    The cycle counter's rate is measured against the high resolution clock
+    between snapshots, so the CPU load comes out right whatever the counter
+    actually counts.
+*/
+class ProcessProfiler
+{
+public:
+    enum class Stage
+    {
+        block,          // the whole of processBlock
+        parameters,     // settings, tempo sync, taps and delay targets
+        delay,          // the delay, filter and feedback loop
+        mixer,          // the dry/wet mix
+        numStages
+    };
+
+    static constexpr int numStages = (int) Stage::numStages;
+
+    struct StageStats
+    {
+        double minimumCycles = 0.0, meanCycles = 0.0, maximumCycles = 0.0;
+    };
+
+    struct Snapshot
+    {
+        std::array<StageStats, (size_t) numStages> stages;
+        double cpuLoad = 0.0;       // time in processBlock over the audio's duration
+        double cyclesPerSecond = 0.0;
+        int numBlocks = 0;
+    };
+
+    static constexpr double snapshotIntervalSeconds = 0.25;
+    static constexpr int fifoSize = 64;
+
+    //==============================================================================
+    void prepare (double sampleRate);
+
+    /** Reads the cycle counter: TSC on x86, the virtual counter on arm64. */
+    static juce::uint64 readCycleCounter() noexcept
+    {
+       #if JUCE_INTEL && (JUCE_MSVC || JUCE_CLANG || JUCE_GCC)
+        return (juce::uint64) __rdtsc();
+       #elif JUCE_ARM && JUCE_64BIT && (JUCE_CLANG || JUCE_GCC)
+        juce::uint64 value;
+        asm volatile ("mrs %0, cntvct_el0" : "=r" (value));
+        return value;
+       #else
+        return (juce::uint64) juce::Time::getHighResolutionTicks();
+       #endif
+    }
+
+    void addStage (Stage stage, juce::uint64 cycles) noexcept
+    {
+        auto& accumulator = accumulators[(size_t) stage];
+
+        if (cycles < accumulator.minimum.load (std::memory_order_relaxed))
+            accumulator.minimum.store (cycles, std::memory_order_relaxed);
+
+        if (cycles > accumulator.maximum.load (std::memory_order_relaxed))
+            accumulator.maximum.store (cycles, std::memory_order_relaxed);
+
+        accumulator.total.store (accumulator.total.load (std::memory_order_relaxed) + cycles, std::memory_order_relaxed);
+        accumulator.count.store (accumulator.count.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    /** Call once per processed block, after its stages; publishes a snapshot when one is due. */
+    void endBlock (int numSamples) noexcept;
+
+    //==============================================================================
+    /** Pops the oldest unread snapshot. Call from one thread only. */
+    bool popSnapshot (Snapshot& snapshot) noexcept;
+
+    /** The CPU load of the most recent snapshot, readable from any thread. */
+    double getLatestCpuLoad() const noexcept          { return latestCpuLoad.load (std::memory_order_relaxed); }
+
+    /** Pops every waiting snapshot and writes it as a CSV row after the given prefix columns. */
+    void writeSnapshots (juce::OutputStream& stream, const juce::String& prefix);
+
+    static juce::String getCsvHeader();
+    static const char* getStageName (Stage stage) noexcept;
+
+    //==============================================================================
+    class ScopedStage
+    {
+    public:
+        ScopedStage (ProcessProfiler& profilerToUse, Stage stageToTime) noexcept
+            : profiler (profilerToUse), stage (stageToTime), start (readCycleCounter())
+        {
+        }
+
+        ~ScopedStage() noexcept
+        {
+            profiler.addStage (stage, readCycleCounter() - start);
+        }
+
+    private:
+        ProcessProfiler& profiler;
+        const Stage stage;
+        const juce::uint64 start;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedStage)
+    };
+
+    /** Times the whole block, then calls endBlock(). */
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock (ProcessProfiler& profilerToUse, int numSamplesInBlock) noexcept
+            : profiler (profilerToUse), numSamples (numSamplesInBlock), start (readCycleCounter())
+        {
+        }
+
+        ~ScopedBlock() noexcept
+        {
+            profiler.addStage (Stage::block, readCycleCounter() - start);
+            profiler.endBlock (numSamples);
+        }
+
+    private:
+        ProcessProfiler& profiler;
+        const int numSamples;
+        const juce::uint64 start;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedBlock)
+    };
+
+private:
+    //==============================================================================
+    struct Accumulator
+    {
+        std::atomic<juce::uint64> minimum { std::numeric_limits<juce::uint64>::max() };
+        std::atomic<juce::uint64> maximum { 0 };
+        std::atomic<juce::uint64> total { 0 };
+        std::atomic<int> count { 0 };
+    };
+
+    void publishSnapshot() noexcept;
+
+    //==============================================================================
+    std::array<Accumulator, (size_t) numStages> accumulators;
+
+    juce::AbstractFifo fifo { fifoSize };
+    std::array<Snapshot, (size_t) fifoSize> snapshots;
+    std::atomic<double> latestCpuLoad { 0.0 };
+
+    double sampleRate = 44100.0;
+    int samplesInWindow = 0;
+    juce::uint64 windowStartCycles = 0;
+    juce::int64 windowStartTicks = 0;
+};
+
+#if FILTERED_DELAY_PROFILING
+ #define FILTERED_DELAY_PROFILE_BLOCK(profiler, numSamples) \
+    const ProcessProfiler::ScopedBlock JUCE_JOIN_MACRO (profiledBlock, __LINE__) (profiler, numSamples)
+ #define FILTERED_DELAY_PROFILE_STAGE(profiler, stage) \
+    const ProcessProfiler::ScopedStage JUCE_JOIN_MACRO (profiledStage, __LINE__) (profiler, ProcessProfiler::Stage::stage)
+#else
+ #define FILTERED_DELAY_PROFILE_BLOCK(profiler, numSamples)
+ #define FILTERED_DELAY_PROFILE_STAGE(profiler, stage)
+#endif
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    RealtimeWorkerPool.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeWorkerPool.h"
+
+//==============================================================================
+class RealtimeWorkerPool::Worker  : public juce::Thread
+{
+public:
+    explicit Worker (RealtimeWorkerPool& ownerPool)
+        : juce::Thread ("FilteredDelay worker"), pool (ownerPool)
+    {
+    }
+
+    void run() override
+    {
+        juce::ScopedNoDenormals noDenormals;
+
+        int idleSpins = 0;
+
+        while (! threadShouldExit())
+        {
+            if (pool.runNextJob())
+                idleSpins = 0;
+            else if (++idleSpins < maxIdleSpins)
+                std::this_thread::yield();
+            else
+                sleep (idleSleepMs);
+        }
+    }
+
+private:
+    RealtimeWorkerPool& pool;
+};
+
+//==============================================================================
+RealtimeWorkerPool::RealtimeWorkerPool() = default;
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    setNumWorkers (0);
+}
+
+void RealtimeWorkerPool::setNumWorkers (int numWorkers)
+{
+    numWorkers = juce::jmax (0, numWorkers);
+
+    // The audio thread only counts the workers that are certain to be there.
+    this->numWorkers.store (juce::jmin (workers.size(), numWorkers), std::memory_order_relaxed);
+
+    while (workers.size() > numWorkers)
+    {
+        auto* worker = workers.getLast();
+        worker->stopThread (1000);
+        workers.removeLast();
+    }
+
+    while (workers.size() < numWorkers)
+    {
+        auto* worker = workers.add (new Worker (*this));
+
+        if (! worker->startRealtimeThread ({}))
+            worker->startThread (juce::Thread::Priority::highest);
+    }
+
+    this->numWorkers.store (numWorkers, std::memory_order_relaxed);
+}
+
+bool RealtimeWorkerPool::hasUnclaimedJobs() const noexcept
+{
+    const auto current = batch.load (std::memory_order_acquire);
+    return (juce::uint32) current < (juce::uint32) (current >> 32);
+}
+
+bool RealtimeWorkerPool::runNextJob() noexcept
+{
+    // Cheap check first, so idle workers don't keep bumping the counter.
+    if (! hasUnclaimedJobs())
+        return false;
+
+    const auto claimed = batch.fetch_add (1, std::memory_order_acq_rel);
+    const auto index = (juce::uint32) claimed;
+
+    if (index >= (juce::uint32) (claimed >> 32))
+        return false;
+
+    currentJob (currentContext, (int) index);
+    jobsRemaining.fetch_sub (1, std::memory_order_release);
+    return true;
+}
+
+void RealtimeWorkerPool::run (int numJobs, Job job, void* context) noexcept
+{
+    if (numJobs <= 0)
+        return;
+
+    currentJob = job;
+    currentContext = context;
+    jobsRemaining.store (numJobs, std::memory_order_relaxed);
+    batch.store ((juce::uint64) numJobs << 32, std::memory_order_release);
+
+    // Whatever no worker has claimed by the time this thread gets to it is run here.
+    while (runNextJob())
+    {
+    }
+
+    // Only jobs a worker has already started are left, one each at most.
+    while (jobsRemaining.load (std::memory_order_acquire) > 0)
+        std::this_thread::yield();
+
+    batch.store (0, std::memory_order_relaxed);
+}
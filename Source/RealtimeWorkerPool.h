@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    RealtimeWorkerPool.h
+
+    Helper threads that share independent jobs with the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A small pool of real-time priority threads that help the audio thread
+    through a batch of independent jobs.
+
+    run() publishes the batch through one atomic and claims jobs alongside
+    the workers, so any job no worker has started is run by the caller. It
+    still waits for jobs a worker has already started, so a worker that is
+    descheduled mid-job holds the block up.
+
+    Idle workers poll: they yield for maxIdleSpins rounds after their last
+    job, then sleep idleSleepMs between checks. The audio thread never
+    signals them.
+*/
+class RealtimeWorkerPool
+{
+public:
+    using Job = void (*) (void* context, int index);
+
+    //==============================================================================
+    RealtimeWorkerPool();
+    ~RealtimeWorkerPool();
+
+    /** Starts or stops threads so numWorkers are running. Not for the audio thread. */
+    void setNumWorkers (int numWorkers);
+    int getNumWorkers() const noexcept              { return numWorkers.load (std::memory_order_relaxed); }
+
+    /** Calls job (context, i) once for every i in [0, numJobs) and returns when all have finished. */
+    void run (int numJobs, Job job, void* context) noexcept;
+
+    static constexpr int maxIdleSpins = 2000;
+    static constexpr int idleSleepMs = 1;
+
+private:
+    //==============================================================================
+    class Worker;
+
+    /** Claims and runs one job of the current batch; false if there was none left. */
+    bool runNextJob() noexcept;
+
+    bool hasUnclaimedJobs() const noexcept;
+
+    //==============================================================================
+    juce::OwnedArray<Worker> workers;
+    std::atomic<int> numWorkers { 0 };
+
+    // The high 32 bits hold the batch size and the low 32 bits the next
+    // unclaimed index, so a claim can never pick up a stale batch size.
+    std::atomic<juce::uint64> batch { 0 };
+    std::atomic<int> jobsRemaining { 0 };
+    Job currentJob = nullptr;
+    void* currentContext = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealtimeWorkerPool)
+};
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    ResponseDisplay.cpp
+
+    The editor's filter response curve and wet level meter.
+
+  ==============================================================================
+*/
+
+#include "ResponseDisplay.h"
+#include "StereoSVF.h"
+
+namespace
+{
+constexpr double lowestFrequencyHz = 20.0;
+constexpr double highestFrequencyHz = 20000.0;
+
+const juce::Colour displayBackground { 0xff101418 };
+const juce::Colour gridColour { 0xff2a3138 };
+const juce::Colour curveColour { 0xffe8e8e8 };
+}
+
+//==============================================================================
+FilterResponseCurve::FilterResponseCurve()
+{
+    setOpaque (true);
+}
+
+void FilterResponseCurve::setResponse (int newFilterType, float newCutoffHz, float newResonance, double newSampleRate)
+{
+    if (newSampleRate <= 0.0)
+        newSampleRate = sampleRate;
+
+    if (newFilterType == filterType && newCutoffHz == cutoff && newResonance == resonance && newSampleRate == sampleRate)
+        return;
+
+    filterType = newFilterType;
+    cutoff = newCutoffHz;
+    resonance = newResonance;
+    sampleRate = newSampleRate;
+
+    rebuildPath();
+    repaint();
+}
+
+double FilterResponseCurve::getMagnitude (int type, double frequencyHz, double cutoffHz, double filterResonance, double rate) noexcept
+{
+    // The TPT filter is the bilinear transform of the analogue state variable
+    // filter, prewarped at the cutoff, so its response is the analogue one at
+    // the warped frequency x = tan (pi f / fs) / g.
+    const auto coefficients = StereoSVF<double>::makeCoefficients (cutoffHz, juce::jmax (0.05, filterResonance), rate);
+    const auto x = std::tan (juce::MathConstants<double>::pi * juce::jmin (frequencyHz, rate * 0.49) / rate) / coefficients.g;
+    const auto denominator = std::hypot (1.0 - x * x, coefficients.R2 * x);
+
+    switch (type)
+    {
+        case 1:  return x * x / denominator;    // highpass
+        case 2:  return x / denominator;        // bandpass
+        default: return 1.0 / denominator;      // lowpass
+    }
+}
+
+void FilterResponseCurve::rebuildPath()
+{
+    responsePath.clear();
+
+    const auto bounds = getLocalBounds().toFloat();
+
+    if (bounds.isEmpty())
+        return;
+
+    const auto topFrequency = juce::jmin (highestFrequencyHz, sampleRate * 0.49);
+    const auto numPoints = juce::jmax (2, getWidth() / 2);
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const auto proportion = (double) i / (double) (numPoints - 1);
+        const auto frequency = lowestFrequencyHz * std::pow (topFrequency / lowestFrequencyHz, proportion);
+        const auto decibels = (float) juce::Decibels::gainToDecibels (getMagnitude (filterType, frequency, cutoff, resonance, sampleRate),
+                                                                      (double) minimumDecibels);
+
+        const auto x = bounds.getX() + (float) proportion * bounds.getWidth();
+        const auto y = juce::jmap (juce::jlimit (minimumDecibels, maximumDecibels, decibels),
+                                   minimumDecibels, maximumDecibels, bounds.getBottom(), bounds.getY());
+
+        if (i == 0)
+            responsePath.startNewSubPath (x, y);
+        else
+            responsePath.lineTo (x, y);
+    }
+}
+
+void FilterResponseCurve::paint (juce::Graphics& g)
+{
+    g.fillAll (displayBackground);
+
+    // A line every 12 dB, with 0 dB picked out.
+    g.setColour (gridColour);
+
+    for (auto decibels = minimumDecibels; decibels <= maximumDecibels; decibels += 12.0f)
+    {
+        const auto y = juce::jmap (decibels, minimumDecibels, maximumDecibels, (float) getHeight(), 0.0f);
+        g.drawHorizontalLine (juce::roundToInt (y), 0.0f, (float) getWidth());
+    }
+
+    g.setColour (curveColour);
+    g.strokePath (responsePath, juce::PathStrokeType (1.5f));
+}
+
+void FilterResponseCurve::resized()
+{
+    rebuildPath();
+}
+
+//==============================================================================
+LevelMeter::LevelMeter()
+{
+    setOpaque (true);
+}
+
+int LevelMeter::getBarHeight (float gain) const noexcept
+{
+    const auto decibels = juce::Decibels::gainToDecibels (gain, minimumDecibels);
+    return juce::roundToInt (juce::jmap (juce::jmin (decibels, 0.0f), minimumDecibels, 0.0f, 0.0f, (float) getHeight()));
+}
+
+void LevelMeter::setLevel (float gain)
+{
+    const auto newBarHeight = getBarHeight (gain);
+
+    if (newBarHeight == barHeight)
+        return;
+
+    barHeight = newBarHeight;
+    repaint();
+}
+
+void LevelMeter::paint (juce::Graphics& g)
+{
+    g.fillAll (displayBackground);
+
+    g.setColour (curveColour);
+    g.fillRect (0, getHeight() - barHeight, getWidth(), barHeight);
+}
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    ResponseDisplay.h
+
+    The editor's filter response curve and wet level meter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    The magnitude response of the delay's state variable filter, drawn on a
+    log frequency axis.
+
+    The curve is worked out into a Path only when the filter settings, the
+    sample rate or the size change; every other repaint just strokes it.
+    The component is opaque so repainting it never repaints the editor's
+    background.
+*/
+class FilterResponseCurve  : public juce::Component
+{
+public:
+    FilterResponseCurve();
+
+    /** Takes the filter's current settings; the curve is only rebuilt if they differ. */
+    void setResponse (int filterType, float cutoffHz, float resonance, double sampleRate);
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+    /** The filter's gain at a frequency, matching StereoSVF exactly. */
+    static double getMagnitude (int filterType, double frequencyHz, double cutoffHz, double resonance, double sampleRate) noexcept;
+
+    static constexpr float minimumDecibels = -48.0f;
+    static constexpr float maximumDecibels = 12.0f;
+
+private:
+    void rebuildPath();
+
+    juce::Path responsePath;
+
+    int filterType = 0;
+    float cutoff = 1000.0f;
+    float resonance = 0.707f;
+    double sampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FilterResponseCurve)
+};
+
+//==============================================================================
+/**
+    A vertical peak meter for the wet signal. The level is given as a gain,
+    already decayed by AnalysisFeed; the meter only repaints when that moves
+    the bar by at least a pixel.
+*/
+class LevelMeter  : public juce::Component
+{
+public:
+    LevelMeter();
+
+    void setLevel (float gain);
+
+    void paint (juce::Graphics&) override;
+
+    static constexpr float minimumDecibels = -60.0f;
+
+private:
+    int barHeight = 0;
+
+    int getBarHeight (float gain) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeter)
+};
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    StereoDelayBuffer.cpp
+
+    Interleaved stereo delay memory with power-of-two indexing.
+
+  ==============================================================================
+*/
+
+#include "StereoDelayBuffer.h"
+
+//==============================================================================
+template <typename SampleType>
+void StereoDelayBuffer<SampleType>::prepare (double sampleRate, double maxDelayMs)
+{
+    jassert (sampleRate > 0.0 && maxDelayMs > 0.0);
+
+    maxDelayInSamples = static_cast<int> (std::ceil (sampleRate * maxDelayMs / 1000.0));
+
+    // Room for the oldest interpolation neighbour, rounded up so the indices
+    // can wrap with a mask.
+    const auto newNumFrames = juce::nextPowerOfTwo (maxDelayInSamples + getInterpolationLookbehind (DelayInterpolation::windowedSinc) + 1);
+
+    // A ring of the same size is kept and just cleared. A new one comes
+    // zeroed from the allocator, so none of it is touched, and the system
+    // needn't back it with memory, until audio is written into it.
+    if (newNumFrames != numFrames || data == nullptr)
+    {
+        numFrames = newNumFrames;
+        mask = numFrames - 1;
+        data.allocate ((size_t) (numFrames * numChannels), true);
+        memoryIsClear = true;
+    }
+
+    // The long range was sized against the old ring and sample rate.
+    longRangeEnabled = false;
+    releaseLongRange();
+
+    reset();
+}
+
+template <typename SampleType>
+void StereoDelayBuffer<SampleType>::reset()
+{
+    if (data != nullptr && ! memoryIsClear)
+        data.clear ((size_t) (numFrames * numChannels));
+
+    memoryIsClear = true;
+
+    if (compactData != nullptr)
+    {
+        compactData.clear ((size_t) (compactNumFrames * numChannels));
+        compactScales.clear ((size_t) (compactNumFrames / compactBlockSize * numChannels));
+    }
+
+    writeIndex = 0;
+    compactBase = archivedWriteIndex = archiveEnd = 0;
+}
+
+//==============================================================================
+template <typename SampleType>
+void StereoDelayBuffer<SampleType>::allocateLongRange (double sampleRate, double maxDelayMs)
+{
+    jassert (sampleRate > 0.0 && numFrames > 0);
+
+    longMaxDelayInSamples = juce::jmax (maxDelayInSamples, static_cast<int> (std::ceil (sampleRate * maxDelayMs / 1000.0)));
+
+    compactNumFrames = juce::jmax (numFrames, juce::nextPowerOfTwo (longMaxDelayInSamples + getInterpolationLookbehind (DelayInterpolation::windowedSinc) + 1));
+    compactMask = compactNumFrames - 1;
+
+    compactData.allocate ((size_t) (compactNumFrames * numChannels), true);
+    compactScales.allocate ((size_t) (compactNumFrames / compactBlockSize * numChannels), true);
+}
+
+template <typename SampleType>
+void StereoDelayBuffer<SampleType>::releaseLongRange()
+{
+    compactData.free();
+    compactScales.free();
+    compactNumFrames = 0;
+    compactMask = 0;
+    longMaxDelayInSamples = 0;
+}
+
+template <typename SampleType>
+void StereoDelayBuffer<SampleType>::setLongRangeEnabled (bool shouldBeEnabled) noexcept
+{
+    jassert (! shouldBeEnabled || compactData != nullptr);
+    shouldBeEnabled = shouldBeEnabled && compactData != nullptr;
+
+    if (shouldBeEnabled == longRangeEnabled)
+        return;
+
+    longRangeEnabled = shouldBeEnabled;
+
+    // Line the two rings up at the write head. The block it's in is still
+    // all in the float ring, so archiving starts from the beginning of it.
+    compactBase = 0;
+    archivedWriteIndex = writeIndex;
+    archiveEnd = ((writeIndex + 1) & ~(compactBlockSize - 1)) & compactMask;
+}
+
+template <typename SampleType>
+void StereoDelayBuffer<SampleType>::archive() noexcept
+{
+    if (! longRangeEnabled)
+        return;
+
+    const auto head = getCompactWriteIndex();
+    compactBase = (head - writeIndex) & compactMask;
+    archivedWriteIndex = writeIndex;
+
+    // A block that's only partly written waits for the next call.
+    for (auto pending = (head + 1 - archiveEnd) & compactMask; pending >= compactBlockSize; pending -= compactBlockSize)
+    {
+        archiveBlock (archiveEnd);
+        archiveEnd = (archiveEnd + compactBlockSize) & compactMask;
+    }
+}
+
+template <typename SampleType>
+void StereoDelayBuffer<SampleType>::archiveBlock (int compactIndex) noexcept
+{
+    // Blocks start on a multiple of compactBlockSize in both rings, so a
+    // block never wraps in either.
+    const auto* source = data.get() + (size_t) ((compactIndex & mask) * numChannels);
+    auto* mantissas = compactData.get() + (size_t) (compactIndex * numChannels);
+    auto* scales = compactScales.get() + (size_t) ((compactIndex / compactBlockSize) * numChannels);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto peak = static_cast<SampleType> (0);
+
+        for (int i = 0; i < compactBlockSize; ++i)
+            peak = juce::jmax (peak, std::abs (source[i * numChannels + channel]));
+
+        if (! (peak > 0 && std::isfinite (peak)))
+        {
+            for (int i = 0; i < compactBlockSize; ++i)
+                mantissas[i * numChannels + channel] = 0;
+
+            scales[channel] = 0.0f;
+            continue;
+        }
+
+        // A power-of-two scale that puts the peak just below full scale, so
+        // scaling back is exact.
+        int exponent = 0;
+        std::frexp (peak, &exponent);
+        const auto toMantissa = std::ldexp (static_cast<SampleType> (1), 15 - exponent);
+
+        for (int i = 0; i < compactBlockSize; ++i)
+            mantissas[i * numChannels + channel] = static_cast<juce::int16> (juce::jlimit (-32767, 32767, juce::roundToInt (source[i * numChannels + channel] * toMantissa)));
+
+        scales[channel] = std::ldexp (1.0f, exponent - 15);
+    }
+}
+
+template <typename SampleType>
+size_t StereoDelayBuffer<SampleType>::getMemoryUsageInBytes() const noexcept
+{
+    return (size_t) (numFrames * numChannels) * sizeof (SampleType)
+         + (size_t) (compactNumFrames * numChannels) * sizeof (juce::int16)
+         + (size_t) (compactNumFrames / compactBlockSize * numChannels) * sizeof (float);
+}
+
+//==============================================================================
+template class StereoDelayBuffer<float>;
+template class StereoDelayBuffer<double>;
@@ -0,0 +1,375 @@
+/*
+  ==============================================================================
+
+    StereoDelayBuffer.h
+
+    Interleaved stereo delay memory with power-of-two indexing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayInterpolation.h"
+#include "StereoFrame.h"
+
+//==============================================================================
+/**
+    Both delay channels in a single allocation.
+
+    Frames are stored interleaved (L, R, L, R...) in a power-of-two ring, so
+    the write head and read positions wrap with a mask instead of a modulo or
+    a branch. The ring is sized in prepare() from the sample rate and the
+    longest delay that will be requested.
+
+    Reads are templated on the DelayInterpolation mode. The Thiran allpass
+    keeps one sample of state per channel, which the caller owns and passes
+    in; other modes ignore it.
+
+    Delays beyond the ring can be served by an optional long range: a second,
+    much larger ring in block floating point, with 16-bit mantissas and one
+    power-of-two scale per channel for every compactBlockSize frames. It
+    costs about half a float ring per frame and a quarter of a double one.
+    The float ring stays the only thing written per sample; archive()
+    converts each completed block into the long range once per process
+    call, and reads past the float ring scale the mantissas back inside the
+    interpolation loop. The long range is allocated on request, off the
+    audio thread, and only holds what was written after it was enabled.
+*/
+template <typename SampleType>
+class StereoDelayBuffer
+{
+public:
+    static constexpr int numChannels = 2;
+
+    //==============================================================================
+    /** Allocates enough memory for maxDelayMs at the given sample rate, or
+        keeps the memory it has if that's the same size, and clears it.
+    */
+    void prepare (double sampleRate, double maxDelayMs);
+
+    /** Clears the delay memory. */
+    void reset();
+
+    /** The coefficient table used by DelayInterpolation::windowedSinc reads. */
+    void setSincTable (const WindowedSincTable<SampleType>* newTable) noexcept    { sincTable = newTable; }
+
+    /** The longest delay that read() can serve, in samples. */
+    int getMaxDelayInSamples() const noexcept    { return longRangeEnabled ? longMaxDelayInSamples : maxDelayInSamples; }
+
+    //==============================================================================
+    /** Allocates the long range for delays up to maxDelayMs. This allocates, so
+        it must not run on the audio thread, and only while the long range is
+        disabled. prepare() releases it again.
+    */
+    void allocateLongRange (double sampleRate, double maxDelayMs);
+
+    /** Frees the long range; it must be disabled. */
+    void releaseLongRange();
+
+    bool hasLongRange() const noexcept           { return compactData != nullptr; }
+
+    /** Serves delays beyond the float ring from the long range, which must
+        have been allocated. Safe on the audio thread.
+    */
+    void setLongRangeEnabled (bool shouldBeEnabled) noexcept;
+
+    /** Converts every block completed since the last call into the long
+        range; call once per process call, after the writes.
+    */
+    void archive() noexcept;
+
+    /** The delay memory held, long range included. */
+    size_t getMemoryUsageInBytes() const noexcept;
+
+    /** Frames per long-range scale. */
+    static constexpr int compactBlockSize = 32;
+
+    //==============================================================================
+    /** Moves the write head on by one frame; call once per sample before write(). */
+    void advance() noexcept
+    {
+        writeIndex = (writeIndex + 1) & mask;
+        memoryIsClear = false;
+    }
+
+    /** Stores a sample at the write head. */
+    void write (int channel, SampleType sample) noexcept
+    {
+        data[(size_t) (writeIndex * numChannels + channel)] = sample;
+    }
+
+    /** Stores a left/right pair at the write head. */
+    void writeFrame (StereoFrame<SampleType> frame) noexcept
+    {
+        auto* destination = data + (size_t) (writeIndex * numChannels);
+        destination[0] = frame[0];
+        destination[1] = frame[1];
+    }
+
+    /** Reads at a fractional delay. A delay of 0 returns the sample just written. */
+    template <DelayInterpolation mode>
+    SampleType read (int channel, SampleType delayInSamples, SampleType& allpassState) const noexcept
+    {
+        jassert (delayInSamples >= 0 && delayInSamples <= (SampleType) getMaxDelayInSamples());
+
+        const auto delayInt = static_cast<int> (delayInSamples);
+        const auto delayFrac = delayInSamples - static_cast<SampleType> (delayInt);
+
+        if (delayInt > maxDelayInSamples)
+            return interpolate<mode, true> (channel, getCompactWriteIndex() - delayInt, delayInt, delayFrac, allpassState);
+
+        return interpolate<mode, false> (channel, writeIndex - delayInt, delayInt, delayFrac, allpassState);
+    }
+
+    /** Stores the next numSamples frames and moves the write head past them. */
+    void writeBlock (const SampleType* left, const SampleType* right, int numSamples) noexcept
+    {
+        auto index = (writeIndex + 1) & mask;
+
+        while (numSamples > 0)
+        {
+            const auto run = juce::jmin (numSamples, numFrames - index);
+            auto* destination = data + (size_t) (index * numChannels);
+
+            for (int i = 0; i < run; ++i)
+            {
+                destination[i * numChannels]     = left[i];
+                destination[i * numChannels + 1] = right[i];
+            }
+
+            left += run;
+            right += run;
+            numSamples -= run;
+            index = (index + run) & mask;
+        }
+
+        writeIndex = (index - 1) & mask;
+        memoryIsClear = false;
+    }
+
+    /** Reads the values that read() will return for each of the next numSamples
+        frames, before they are written.
+
+        This only holds when none of those frames is needed by the read itself,
+        i.e. numSamples <= delayInSamples - getInterpolationLookahead (mode).
+        For linear reads each contiguous run of the ring is a plain strided
+        interpolation with no masking.
+    */
+    template <DelayInterpolation mode>
+    void readBlock (int channel, SampleType delayInSamples, SampleType* destination, int numSamples, SampleType& allpassState) const noexcept
+    {
+        jassert (numSamples <= static_cast<int> (delayInSamples) - getInterpolationLookahead (mode));
+        jassert (delayInSamples <= (SampleType) getMaxDelayInSamples());
+
+        const auto delayInt = static_cast<int> (delayInSamples);
+        const auto delayFrac = delayInSamples - static_cast<SampleType> (delayInt);
+
+        if (delayInt > maxDelayInSamples)
+        {
+            const auto compactIndex = getCompactWriteIndex() + 1 - delayInt;
+
+            for (int i = 0; i < numSamples; ++i)
+                destination[i] = interpolate<mode, true> (channel, compactIndex + i, delayInt, delayFrac, allpassState);
+
+            return;
+        }
+
+        auto index = (writeIndex + 1 - delayInt) & mask;
+
+        if constexpr (mode != DelayInterpolation::linear)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                destination[i] = interpolate<mode, false> (channel, index + i, delayInt, delayFrac, allpassState);
+        }
+        else
+        {
+            const auto* samples = data.get() + channel;
+
+            while (numSamples > 0)
+            {
+                if (index == 0)
+                {
+                    // The older neighbour of the first frame wraps to the end of the ring.
+                    const auto value1 = samples[0];
+                    const auto value2 = samples[(size_t) (mask * numChannels)];
+                    *destination++ = value1 + delayFrac * (value2 - value1);
+
+                    index = 1;
+                    --numSamples;
+                    continue;
+                }
+
+                const auto run = juce::jmin (numSamples, numFrames - index);
+                const auto* newer = samples + (size_t) (index * numChannels);
+                const auto* older = newer - numChannels;
+
+                for (int i = 0; i < run; ++i)
+                    destination[i] = newer[i * numChannels] + delayFrac * (older[i * numChannels] - newer[i * numChannels]);
+
+                destination += run;
+                numSamples -= run;
+                index = (index + run) & mask;
+            }
+        }
+    }
+
+    /** Like readBlock(), but with a separate delay for each frame, as a
+        modulated read head needs. Frame i must satisfy
+        i < delaysInSamples[i] - getInterpolationLookahead (mode).
+    */
+    template <DelayInterpolation mode>
+    void readBlock (int channel, const SampleType* delaysInSamples, SampleType* destination, int numSamples, SampleType& allpassState) const noexcept
+    {
+        const auto index = writeIndex + 1;
+        const auto compactIndex = longRangeEnabled ? getCompactWriteIndex() + 1 : 0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto delayInt = static_cast<int> (delaysInSamples[i]);
+            const auto delayFrac = delaysInSamples[i] - static_cast<SampleType> (delayInt);
+            jassert (i < delayInt - getInterpolationLookahead (mode));
+            jassert (delaysInSamples[i] <= (SampleType) getMaxDelayInSamples());
+
+            destination[i] = delayInt > maxDelayInSamples
+                               ? interpolate<mode, true>  (channel, compactIndex + i - delayInt, delayInt, delayFrac, allpassState)
+                               : interpolate<mode, false> (channel, index + i - delayInt, delayInt, delayFrac, allpassState);
+        }
+    }
+
+    /** Reads both channels, each at its own delay. */
+    template <DelayInterpolation mode>
+    StereoFrame<SampleType> readFrame (SampleType delayLeft, SampleType delayRight, StereoFrame<SampleType>& allpassState) const noexcept
+    {
+        return { { read<mode> (0, delayLeft, allpassState[0]), read<mode> (1, delayRight, allpassState[1]) } };
+    }
+
+private:
+    //==============================================================================
+    /** A sample from the float ring, or from the long range, by its own index. */
+    template <bool longRange>
+    SampleType sampleAt (int channel, int index) const noexcept
+    {
+        if constexpr (longRange)
+        {
+            index &= compactMask;
+            return static_cast<SampleType> (compactData[(size_t) (index * numChannels + channel)])
+                 * static_cast<SampleType> (compactScales[(size_t) ((index / compactBlockSize) * numChannels + channel)]);
+        }
+        else
+        {
+            return data[(size_t) ((index & mask) * numChannels + channel)];
+        }
+    }
+
+    /** The long range's index for the frame at the write head. */
+    int getCompactWriteIndex() const noexcept
+    {
+        // The head has wrapped round the float ring since archive() last ran
+        // if it's now behind where it was then.
+        return (compactBase + writeIndex + (writeIndex < archivedWriteIndex ? numFrames : 0)) & compactMask;
+    }
+
+    void archiveBlock (int compactIndex) noexcept;
+
+    /** Interpolates around the frame at index, which lies delayInt frames behind the read position. */
+    template <DelayInterpolation mode, bool longRange>
+    SampleType interpolate (int channel, int index, int delayInt, SampleType delayFrac, SampleType& allpassState) const noexcept
+    {
+        if constexpr (mode == DelayInterpolation::linear)
+        {
+            const auto value1 = sampleAt<longRange> (channel, index);
+            const auto value2 = sampleAt<longRange> (channel, index - 1);
+
+            return value1 + delayFrac * (value2 - value1);
+        }
+        else if constexpr (mode == DelayInterpolation::lagrange3rd)
+        {
+            // Centre the four points around the read position, as juce::dsp::DelayLine does.
+            if (delayInt >= 1)
+            {
+                ++index;
+                delayFrac += 1;
+            }
+
+            const auto value1 = sampleAt<longRange> (channel, index);
+            const auto value2 = sampleAt<longRange> (channel, index - 1);
+            const auto value3 = sampleAt<longRange> (channel, index - 2);
+            const auto value4 = sampleAt<longRange> (channel, index - 3);
+
+            const auto d1 = delayFrac - static_cast<SampleType> (1);
+            const auto d2 = delayFrac - static_cast<SampleType> (2);
+            const auto d3 = delayFrac - static_cast<SampleType> (3);
+
+            const auto c1 = -d1 * d2 * d3 / static_cast<SampleType> (6);
+            const auto c2 = d2 * d3 * static_cast<SampleType> (0.5);
+            const auto c3 = -d1 * d3 * static_cast<SampleType> (0.5);
+            const auto c4 = d1 * d2 / static_cast<SampleType> (6);
+
+            return value1 * c1 + delayFrac * (value2 * c2 + value3 * c3 + value4 * c4);
+        }
+        else if constexpr (mode == DelayInterpolation::thiran)
+        {
+            // Keep the fraction in the range where the allpass stays well behaved.
+            if (delayFrac < static_cast<SampleType> (0.618) && delayInt >= 1)
+            {
+                ++index;
+                delayFrac += 1;
+            }
+
+            const auto value1 = sampleAt<longRange> (channel, index);
+            const auto value2 = sampleAt<longRange> (channel, index - 1);
+
+            if (delayFrac == 0)
+                return allpassState = value1;
+
+            const auto alpha = (static_cast<SampleType> (1) - delayFrac) / (static_cast<SampleType> (1) + delayFrac);
+            return allpassState = value2 + alpha * (value1 - allpassState);
+        }
+        else
+        {
+            jassert (sincTable != nullptr);
+            juce::ignoreUnused (delayInt);
+
+            constexpr auto numTaps = WindowedSincTable<SampleType>::numTaps;
+            const auto phasePosition = delayFrac * static_cast<SampleType> (WindowedSincTable<SampleType>::numPhases);
+            const auto phase = static_cast<int> (phasePosition);
+            const auto phaseFrac = phasePosition - static_cast<SampleType> (phase);
+
+            const auto* coefficients1 = sincTable->getCoefficients (phase);
+            const auto* coefficients2 = sincTable->getCoefficients (phase + 1);
+
+            // Tap t weights the sample at delay (delayInt + t - 3).
+            const auto newest = index + (numTaps / 2 - 1);
+            SampleType sum = 0;
+
+            for (int tap = 0; tap < numTaps; ++tap)
+                sum += sampleAt<longRange> (channel, newest - tap) * (coefficients1[tap] + phaseFrac * (coefficients2[tap] - coefficients1[tap]));
+
+            return sum;
+        }
+    }
+
+    //==============================================================================
+    const WindowedSincTable<SampleType>* sincTable = nullptr;
+    juce::HeapBlock<SampleType> data;
+    int numFrames = 0;
+    int mask = 0;
+    int writeIndex = 0;
+    int maxDelayInSamples = 0;
+    bool memoryIsClear = true;      // nothing written since the ring was last zeroed
+
+    // The long range. Its ring is a whole number of float rings, so a frame's
+    // index in one is its index in the other plus compactBase. Only the audio
+    // thread touches anything beyond the allocation while it's enabled.
+    juce::HeapBlock<juce::int16> compactData;
+    juce::HeapBlock<float> compactScales;
+    int compactNumFrames = 0;
+    int compactMask = 0;
+    int longMaxDelayInSamples = 0;
+    bool longRangeEnabled = false;
+    int compactBase = 0;
+    int archivedWriteIndex = 0;     // writeIndex when archive() last ran
+    int archiveEnd = 0;             // the first long-range frame not converted yet
+};
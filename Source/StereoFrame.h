@@ -0,0 +1,40 @@
+/*
+  ==============================================================================
+
+    StereoFrame.h
+
+    A left/right sample pair that the delay kernels treat as one value.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Two lanes, left and right, processed together.
+
+    The arithmetic is written lane-wise on an aligned pair so the compiler
+    keeps a whole frame in one vector register: a full SSE2/NEON register for
+    double, the low half for float. juce::dsp::SIMDRegister would give four
+    float lanes, half of which would sit idle for a stereo signal and need
+    padded loads from the interleaved delay memory.
+*/
+template <typename SampleType>
+struct StereoFrame
+{
+    alignas (2 * sizeof (SampleType)) SampleType lanes[2];
+
+    //==============================================================================
+    static StereoFrame fromScalar (SampleType value) noexcept            { return { { value, value } }; }
+
+    SampleType& operator[] (size_t lane) noexcept                        { return lanes[lane]; }
+    SampleType operator[] (size_t lane) const noexcept                   { return lanes[lane]; }
+
+    StereoFrame operator+ (StereoFrame other) const noexcept             { return { { lanes[0] + other.lanes[0], lanes[1] + other.lanes[1] } }; }
+    StereoFrame operator- (StereoFrame other) const noexcept             { return { { lanes[0] - other.lanes[0], lanes[1] - other.lanes[1] } }; }
+    StereoFrame operator* (StereoFrame other) const noexcept             { return { { lanes[0] * other.lanes[0], lanes[1] * other.lanes[1] } }; }
+    StereoFrame operator* (SampleType scalar) const noexcept             { return { { lanes[0] * scalar, lanes[1] * scalar } }; }
+};
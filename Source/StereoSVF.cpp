@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    StereoSVF.cpp
+
+    Topology-preserving state variable filter running both channels at once.
+
+  ==============================================================================
+*/
+
+#include "StereoSVF.h"
+
+//==============================================================================
+template <typename SampleType>
+void StereoSVF<SampleType>::prepare (double newSampleRate)
+{
+    jassert (newSampleRate > 0.0);
+
+    sampleRate = newSampleRate;
+    update();
+    reset();
+}
+
+template <typename SampleType>
+void StereoSVF<SampleType>::reset() noexcept
+{
+    s1 = {};
+    s2 = {};
+}
+
+template <typename SampleType>
+void StereoSVF<SampleType>::setCutoffFrequency (SampleType newCutoffHz)
+{
+    jassert (newCutoffHz > 0);
+
+    cutoffFrequency = newCutoffHz;
+    update();
+}
+
+template <typename SampleType>
+void StereoSVF<SampleType>::setResonance (SampleType newResonance)
+{
+    // RESONANCE goes down to 0, which would make R2 infinite.
+    resonance = juce::jmax (static_cast<SampleType> (0.05), newResonance);
+    update();
+}
+
+template <typename SampleType>
+void StereoSVF<SampleType>::glideTo (SampleType newCutoffHz, SampleType newResonance, int numSamples) noexcept
+{
+    cutoffFrequency = newCutoffHz;
+    resonance = juce::jmax (static_cast<SampleType> (0.05), newResonance);
+
+    const auto target = makeCoefficients (static_cast<double> (cutoffFrequency), static_cast<double> (resonance), sampleRate);
+
+    if (numSamples <= 0 || (target.g == g && target.R2 == R2 && target.h == h))
+    {
+        update();
+        return;
+    }
+
+    // g and R2 are what the cutoff and resonance actually set; h only
+    // normalises, and a straight line between its end points is close
+    // enough over one control period.
+    const auto numSteps = static_cast<SampleType> (numSamples);
+
+    glideTarget = target;
+    glideStep = { (target.g - g) / numSteps, (target.R2 - R2) / numSteps, (target.h - h) / numSteps };
+    glideSamplesLeft = numSamples;
+}
+
+template <typename SampleType>
+void StereoSVF<SampleType>::snapToZero() noexcept
+{
+    for (size_t lane = 0; lane < 2; ++lane)
+    {
+        juce::dsp::util::snapToZero (s1[lane]);
+        juce::dsp::util::snapToZero (s2[lane]);
+    }
+}
+
+template <typename SampleType>
+typename StereoSVF<SampleType>::Coefficients StereoSVF<SampleType>::makeCoefficients (double cutoffHz, double resonance, double sampleRate) noexcept
+{
+    // Keep the cutoff below Nyquist so tan() stays finite at low sample rates.
+    const auto cutoff = juce::jmin (cutoffHz, sampleRate * 0.49);
+
+    const auto g  = std::tan (juce::MathConstants<double>::pi * cutoff / sampleRate);
+    const auto R2 = 1.0 / resonance;
+    const auto h  = 1.0 / (1.0 + R2 * g + g * g);
+
+    return { static_cast<SampleType> (g), static_cast<SampleType> (R2), static_cast<SampleType> (h) };
+}
+
+template <typename SampleType>
+void StereoSVF<SampleType>::update()
+{
+    const auto coefficients = makeCoefficients (static_cast<double> (cutoffFrequency), static_cast<double> (resonance), sampleRate);
+
+    glideSamplesLeft = 0;
+    g  = coefficients.g;
+    R2 = coefficients.R2;
+    h  = coefficients.h;
+}
+
+//==============================================================================
+template class StereoSVF<float>;
+template class StereoSVF<double>;
@@ -0,0 +1,171 @@
+/*
+  ==============================================================================
+
+    StereoSVF.h
+
+    Topology-preserving state variable filter running both channels at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StereoFrame.h"
+
+//==============================================================================
+/**
+    The same TPT state variable filter as juce::dsp::StateVariableTPTFilter,
+    with the left and right integrator states held as StereoFrame lanes so a
+    single pass filters both channels with shared coefficients.
+*/
+template <typename SampleType>
+class StereoSVF
+{
+public:
+    using Type  = juce::dsp::StateVariableTPTFilterType;
+    using Frame = StereoFrame<SampleType>;
+
+    //==============================================================================
+    void prepare (double newSampleRate);
+    void reset() noexcept;
+
+    void setType (Type newType) noexcept                      { type = newType; }
+    void setCutoffFrequency (SampleType newCutoffHz);
+    void setResonance (SampleType newResonance);
+
+    Type getType() const noexcept                             { return type; }
+    SampleType getCutoffFrequency() const noexcept            { return cutoffFrequency; }
+    SampleType getResonance() const noexcept                  { return resonance; }
+
+    /** The filter's g, R2 and h terms for a cutoff, resonance and sample rate. */
+    struct Coefficients
+    {
+        SampleType g = 0, R2 = 0, h = 0;
+    };
+
+    static Coefficients makeCoefficients (double cutoffHz, double resonance, double sampleRate) noexcept;
+
+    /** Moves g, R2 and h in equal steps from where they are to the values for
+        a new cutoff and resonance, arriving after numSamples frames of
+        processFrameGliding(). Used for control-rate modulation, so the
+        coefficients are only worked out once per control period.
+        setCutoffFrequency() and setResonance() cancel a glide.
+    */
+    void glideTo (SampleType newCutoffHz, SampleType newResonance, int numSamples) noexcept;
+
+    bool isGliding() const noexcept                           { return glideSamplesLeft > 0; }
+
+    //==============================================================================
+    /** Filters one frame; the response is a template argument so the kernel has no branch. */
+    template <Type responseType>
+    Frame processFrame (Frame input) noexcept
+    {
+        const auto yHP = (input - s1 * (g + R2) - s2) * h;
+
+        const auto yBP = yHP * g + s1;
+        s1 = yHP * g + yBP;
+
+        const auto yLP = yBP * g + s2;
+        s2 = yBP * g + yLP;
+
+        if constexpr (responseType == Type::lowpass)        return yLP;
+        else if constexpr (responseType == Type::highpass)  return yHP;
+        else                                                return yBP;
+    }
+
+    /** processFrame() that also takes the next step of a glide started by glideTo(). */
+    template <Type responseType>
+    Frame processFrameGliding (Frame input) noexcept
+    {
+        advanceGlide();
+        return processFrame<responseType> (input);
+    }
+
+    /** Filters the left lane only, leaving the right lane's state as it was. */
+    template <Type responseType>
+    SampleType processLeftLane (SampleType input) noexcept
+    {
+        auto& state1 = s1[0];
+        auto& state2 = s2[0];
+
+        const auto yHP = (input - state1 * (g + R2) - state2) * h;
+
+        const auto yBP = yHP * g + state1;
+        state1 = yHP * g + yBP;
+
+        const auto yLP = yBP * g + state2;
+        state2 = yBP * g + yLP;
+
+        if constexpr (responseType == Type::lowpass)        return yLP;
+        else if constexpr (responseType == Type::highpass)  return yHP;
+        else                                                return yBP;
+    }
+
+    /** Filters one frame and blends two responses: fromType at position 0,
+        toType at position 1. Used while a change of type is crossfaded.
+    */
+    Frame processFrameCrossfade (Frame input, Type fromType, Type toType, SampleType position) noexcept
+    {
+        advanceGlide();
+
+        const auto yHP = (input - s1 * (g + R2) - s2) * h;
+
+        const auto yBP = yHP * g + s1;
+        s1 = yHP * g + yBP;
+
+        const auto yLP = yBP * g + s2;
+        s2 = yBP * g + yLP;
+
+        auto response = [&] (Type responseType)
+        {
+            return responseType == Type::lowpass ? yLP : responseType == Type::highpass ? yHP : yBP;
+        };
+
+        const auto from = response (fromType);
+        return from + (response (toType) - from) * position;
+    }
+
+    /** True when both lanes hold bit-identical state. */
+    bool lanesMatch() const noexcept        { return s1[0] == s1[1] && s2[0] == s2[1]; }
+
+    /** Copies the left lane's state into the right lane. */
+    void mirrorLeftLane() noexcept          { s1[1] = s1[0]; s2[1] = s2[0]; }
+
+    /** Flushes denormal state; call once per block. */
+    void snapToZero() noexcept;
+
+private:
+    //==============================================================================
+    void update();
+
+    void advanceGlide() noexcept
+    {
+        if (glideSamplesLeft <= 0)
+            return;
+
+        // The last step lands exactly on the target rather than close to it.
+        if (--glideSamplesLeft == 0)
+        {
+            g  = glideTarget.g;
+            R2 = glideTarget.R2;
+            h  = glideTarget.h;
+            return;
+        }
+
+        g  += glideStep.g;
+        R2 += glideStep.R2;
+        h  += glideStep.h;
+    }
+
+    Frame s1 {}, s2 {};
+    SampleType g = 0, h = 0, R2 = 0;
+
+    double sampleRate = 44100.0;
+    SampleType cutoffFrequency = static_cast<SampleType> (1000.0);
+    SampleType resonance = static_cast<SampleType> (1.0 / juce::MathConstants<double>::sqrt2);
+    Type type = Type::lowpass;
+
+    Coefficients glideTarget, glideStep;
+    int glideSamplesLeft = 0;
+};
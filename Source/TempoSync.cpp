@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    TempoSync.cpp
+
+    Converts the host tempo and the selected note value into a delay time.
+
+  ==============================================================================
+*/
+
+#include "TempoSync.h"
+
+//==============================================================================
+void TempoSync::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    delayInSamples.reset (sampleRate, glideTimeSeconds);
+    reset();
+}
+
+void TempoSync::reset()
+{
+    wasPlaying = false;
+    snapToTarget = true;
+    updateTarget();
+}
+
+void TempoSync::updateFromPlayHead (juce::AudioPlayHead* playHead)
+{
+    juce::Optional<juce::AudioPlayHead::PositionInfo> position;
+
+    if (playHead != nullptr)
+        position = playHead->getPosition();
+
+    if (! position.hasValue())
+    {
+        ppqPosition = {};
+        return;
+    }
+
+    ppqPosition = position->getPpqPosition();
+
+    const auto isPlaying = position->getIsPlaying();
+
+    if (isPlaying && ! wasPlaying)
+        snapToTarget = true;
+
+    wasPlaying = isPlaying;
+
+    if (const auto hostBpm = position->getBpm())
+    {
+        // Some hosts report 0 or garbage while stopped or during setup.
+        if (std::isfinite (*hostBpm) && *hostBpm > 0.0 && *hostBpm != bpm)
+        {
+            bpm = juce::jlimit (1.0, 999.0, *hostBpm);
+            updateTarget();
+        }
+    }
+
+    if (snapToTarget)
+        updateTarget();
+}
+
+void TempoSync::setSubdivision (int index)
+{
+    index = juce::jlimit (0, numSubdivisions - 1, index);
+
+    if (index == subdivisionIndex)
+        return;
+
+    subdivisionIndex = index;
+    snapToTarget = true;
+    updateTarget();
+}
+
+float TempoSync::getNextDelayInSamples (int numSamples)
+{
+    return delayInSamples.skip (numSamples);
+}
+
+float TempoSync::getSubdivisionInBeats (int index) noexcept
+{
+    return subdivisions[(size_t) juce::jlimit (0, numSubdivisions - 1, index)];
+}
+
+void TempoSync::updateTarget()
+{
+    const auto target = static_cast<float> (60.0 / bpm * subdivisions[(size_t) subdivisionIndex] * sampleRate);
+
+    if (snapToTarget)
+        delayInSamples.setCurrentAndTargetValue (target);
+    else
+        delayInSamples.setTargetValue (target);
+
+    snapToTarget = false;
+}
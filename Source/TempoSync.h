@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    TempoSync.h
+
+    Converts the host tempo and the selected note value into a delay time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Works out the tempo-synced delay time for the processor.
+
+    The host position is read once per block. When there is no playhead, or
+    the host doesn't report a tempo, the last known tempo is kept so the delay
+    never falls back to an arbitrary value mid-song. Tempo changes glide over a
+    short time; changing the note value or starting the transport jumps
+    straight to the new time and leaves the smoothing to the delay line.
+*/
+class TempoSync
+{
+public:
+    static constexpr int numSubdivisions = 13;
+
+    //==============================================================================
+    void prepare (double newSampleRate);
+    void reset();
+
+    /** Reads tempo, PPQ position and transport state. Safe to pass nullptr. */
+    void updateFromPlayHead (juce::AudioPlayHead* playHead);
+
+    /** Selects one of the SYNC_RATE_CHOICE note values; out-of-range indices are clamped. */
+    void setSubdivision (int index);
+
+    /** Advances the tempo glide by a block and returns the synced delay in samples. */
+    float getNextDelayInSamples (int numSamples);
+
+    double getBpm() const noexcept                          { return bpm; }
+    juce::Optional<double> getPpqPosition() const noexcept  { return ppqPosition; }
+
+    /** Length of a SYNC_RATE_CHOICE note value in quarter notes. */
+    static float getSubdivisionInBeats (int index) noexcept;
+
+private:
+    //==============================================================================
+    void updateTarget();
+
+    static constexpr std::array<float, numSubdivisions> subdivisions { 0.25f, (0.5f/3.0f), 0.375f, 0.5f, (1.0f/3.0f), 0.75f, 1.0f, (2.0f/3.0f), 1.5f, 2.0f, (4.0f/3.0f), 3.0f, 4.0f };
+
+    static constexpr double defaultBpm = 120.0;
+    static constexpr double glideTimeSeconds = 0.25;
+
+    double sampleRate = 44100.0;
+    double bpm = defaultBpm;
+    juce::Optional<double> ppqPosition;
+    bool wasPlaying = false;
+    bool snapToTarget = true;
+    int subdivisionIndex = 3;
+
+    juce::SmoothedValue<float> delayInSamples;
+};
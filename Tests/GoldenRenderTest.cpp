@@ -0,0 +1,478 @@
+/*
+  ==============================================================================
+
+    Golden-render regression test for FilteredDelayAudioProcessor.
+
+    Renders fixed stimuli (impulse, sine sweep, noise) through every
+    FILTER_TYPE, every SYNC_RATE_CHOICE plus a free-running time, and a
+    range of FEEDBACK settings, and compares the processor's output, in both
+    single and double precision, with the expected output sample by sample.
+
+    The expected output is a set of WAV files recorded from the processor's
+    own float render with --record, kept in Tests/Golden, so a change that
+    alters the sound shows up as a failure. With --reference the expected
+    output is rendered live instead, by ReferenceDelay, a plain per-sample
+    model of the loop written from the plugin's description.
+
+    A sample passes when it is within --ulp units in the last place of the
+    expected value, or when the error is below --db relative to the case's
+    peak level. Failing cases are listed, and --report writes a summary CSV
+    and a difference WAV for each of them.
+
+    Options:
+        --golden=<dir>      compare against <dir>/<case>.wav
+        --record            with --golden, write the processor's renders there
+        --reference         compare against ReferenceDelay instead
+        --report=<dir>      write summary.csv and <case>_diff.wav for failures
+        --ulp=<n>           ULP tolerance (default 64)
+        --db=<level>        error floor in dB below the peak (default -90)
+        --case=<text>       only run cases whose names contain <text>
+
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+#include "ReferenceDelay.h"
+
+#include <iostream>
+
+namespace
+{
+//==============================================================================
+struct TestPlayHead  : public juce::AudioPlayHead
+{
+    juce::Optional<PositionInfo> getPosition() const override
+    {
+        PositionInfo info;
+        info.setBpm (bpm);
+        info.setIsPlaying (true);
+        return info;
+    }
+
+    // Slow enough that the longest subdivision, four beats, fits within RATE's range.
+    double bpm = 180.0;
+};
+
+enum class Stimulus { impulse, sweep, noise };
+
+struct RenderCase
+{
+    juce::String name;
+    Stimulus stimulus;
+    int filterType;
+    int syncRate;       // -1 for the free-running RATE
+    float feedback;
+};
+
+struct Tolerance
+{
+    int maxUlp = 64;
+    double floorDb = -90.0;
+};
+
+struct Comparison
+{
+    double maxError = 0.0;
+    double maxErrorDb = -std::numeric_limits<double>::infinity();
+    juce::int64 maxUlp = 0;
+    int numFailingSamples = 0;
+};
+
+constexpr double sampleRate = 48000.0;
+constexpr int blockSize = 256;
+constexpr int numChannels = 2;
+constexpr double renderSeconds = 1.5;
+constexpr double stimulusSeconds = 0.75;
+constexpr float freeRateMs = 350.0f;
+constexpr float feedbackSettings[] { 0.0f, 0.5f, 0.95f };
+
+// Everything the cases don't vary.
+const std::vector<std::pair<juce::String, float>> fixedValues
+{
+    { "RATE", freeRateMs },
+    { "WIDTH", 2.5f },
+    { "MIX", 0.5f },
+    { "CUTOFF", 2000.0f },
+    { "RESONANCE", 0.7f },
+    { "MOD_BP", 1.0f },
+    { "INTERPOLATION", 0.0f },
+    { "OVERSAMPLING", 0.0f },
+    { "TAP_COUNT", 0.0f }
+};
+
+//==============================================================================
+std::vector<RenderCase> makeCases()
+{
+    const char* stimulusNames[] { "impulse", "sweep", "noise" };
+    const char* filterNames[] { "lowpass", "highpass", "bandpass" };
+
+    std::vector<RenderCase> cases;
+
+    for (int stimulus = 0; stimulus < 3; ++stimulus)
+        for (int filterType = 0; filterType < 3; ++filterType)
+            for (int syncRate = -1; syncRate < TempoSync::numSubdivisions; ++syncRate)
+                for (auto feedback : feedbackSettings)
+                    cases.push_back ({ juce::String (stimulusNames[stimulus]) + "_" + filterNames[filterType]
+                                         + (syncRate < 0 ? juce::String ("_free") : "_sync" + juce::String (syncRate))
+                                         + "_fb" + juce::String (juce::roundToInt (feedback * 100.0f)),
+                                       (Stimulus) stimulus, filterType, syncRate, feedback });
+
+    return cases;
+}
+
+juce::AudioBuffer<float> makeStimulus (Stimulus stimulus)
+{
+    const auto numSamples = (int) (renderSeconds * sampleRate);
+    const auto numStimulusSamples = (int) (stimulusSeconds * sampleRate);
+
+    juce::AudioBuffer<float> buffer (numChannels, numSamples);
+    buffer.clear();
+
+    juce::Random random (0x5eed);
+
+    for (int sample = 0; sample < numStimulusSamples; ++sample)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            float value = 0.0f;
+
+            if (stimulus == Stimulus::impulse)
+            {
+                value = sample == 0 ? 1.0f : 0.0f;
+            }
+            else if (stimulus == Stimulus::sweep)
+            {
+                // Exponential sweep from 20 Hz to 20 kHz.
+                const auto t = sample / sampleRate;
+                const auto rate = std::log (1000.0) / stimulusSeconds;
+                value = 0.5f * (float) std::sin (juce::MathConstants<double>::twoPi * 20.0 * (std::exp (rate * t) - 1.0) / rate);
+            }
+            else
+            {
+                value = (random.nextFloat() * 2.0f - 1.0f) * 0.25f;
+            }
+
+            buffer.setSample (channel, sample, value);
+        }
+    }
+
+    return buffer;
+}
+
+//==============================================================================
+juce::RangedAudioParameter* findParameter (juce::AudioProcessor& processor, const juce::String& parameterID)
+{
+    for (auto* parameter : processor.getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter))
+            if (ranged->getParameterID() == parameterID)
+                return ranged;
+
+    jassertfalse;
+    return nullptr;
+}
+
+void setParameter (juce::AudioProcessor& processor, const juce::String& parameterID, float value)
+{
+    if (auto* parameter = findParameter (processor, parameterID))
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+}
+
+/** The value a parameter actually holds, after snapping to its interval. */
+float getParameter (juce::AudioProcessor& processor, const juce::String& parameterID)
+{
+    auto* parameter = findParameter (processor, parameterID);
+    return parameter != nullptr ? parameter->convertFrom0to1 (parameter->getValue()) : 0.0f;
+}
+
+void applyCase (juce::AudioProcessor& processor, const RenderCase& renderCase)
+{
+    for (const auto& [parameterID, value] : fixedValues)
+        setParameter (processor, parameterID, value);
+
+    setParameter (processor, "FILTER_TYPE", (float) renderCase.filterType);
+    setParameter (processor, "FEEDBACK", renderCase.feedback);
+    setParameter (processor, "BPM_SYNC", renderCase.syncRate >= 0 ? 1.0f : 0.0f);
+    setParameter (processor, "SYNC_RATE_CHOICE", (float) juce::jmax (0, renderCase.syncRate));
+}
+
+//==============================================================================
+/** Renders in SampleType and returns the result as float, for comparing and storing. */
+template <typename SampleType>
+juce::AudioBuffer<float> renderProcessor (const RenderCase& renderCase, const juce::AudioBuffer<float>& stimulus, TestPlayHead& playHead)
+{
+    FilteredDelayAudioProcessor processor;
+    applyCase (processor, renderCase);
+
+    processor.setProcessingPrecision (std::is_same_v<SampleType, double> ? juce::AudioProcessor::doublePrecision
+                                                                          : juce::AudioProcessor::singlePrecision);
+    processor.setPlayHead (&playHead);
+    processor.setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+
+    juce::AudioBuffer<SampleType> output;
+    output.makeCopyOf (stimulus);
+    juce::MidiBuffer midi;
+
+    for (int start = 0; start < output.getNumSamples(); start += blockSize)
+    {
+        juce::AudioBuffer<SampleType> block (output.getArrayOfWritePointers(), numChannels, start,
+                                             juce::jmin (blockSize, output.getNumSamples() - start));
+        processor.processBlock (block, midi);
+    }
+
+    processor.releaseResources();
+
+    juce::AudioBuffer<float> result;
+    result.makeCopyOf (output);
+    return result;
+}
+
+/** What the plugin's description says the case should sound like. */
+juce::AudioBuffer<float> renderReference (const RenderCase& renderCase, const juce::AudioBuffer<float>& stimulus, double bpm)
+{
+    // Only used to read back the snapped parameter values.
+    FilteredDelayAudioProcessor parameterSource;
+    applyCase (parameterSource, renderCase);
+
+    const auto widthInSamples = getParameter (parameterSource, "WIDTH") / 1000.0 * sampleRate;
+    const auto mix = getParameter (parameterSource, "MIX");
+
+    // A synced time is a number of beats at the host's tempo, and applies
+    // from the first sample.
+    const auto delayInSamples = renderCase.syncRate >= 0 ? 60.0 / bpm * TempoSync::getSubdivisionInBeats (renderCase.syncRate) * sampleRate
+                                                         : getParameter (parameterSource, "RATE") / 1000.0 * sampleRate;
+    const auto filterType = (ReferenceDelay<float>::FilterType) renderCase.filterType;
+
+    juce::AudioBuffer<float> output (stimulus);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        // WIDTH lengthens the left channel's delay.
+        ReferenceDelay<float> reference (sampleRate, delayInSamples + (channel == 0 ? widthInSamples : 0.0), filterType,
+                                         getParameter (parameterSource, "CUTOFF"),
+                                         getParameter (parameterSource, "RESONANCE"),
+                                         getParameter (parameterSource, "FEEDBACK"));
+
+        auto* samples = output.getWritePointer (channel);
+
+        for (int i = 0; i < output.getNumSamples(); ++i)
+        {
+            const auto dry = samples[i];
+            const auto wet = reference.processSample (dry);
+            samples[i] = wet * mix + dry * (1.0f - mix);
+        }
+    }
+
+    return output;
+}
+
+//==============================================================================
+juce::int64 getUlpDistance (float a, float b)
+{
+    // Maps the float bit patterns onto a monotonic integer line.
+    auto toOrdered = [] (float value)
+    {
+        juce::int32 bits;
+        std::memcpy (&bits, &value, sizeof (bits));
+        return bits < 0 ? (juce::int64) std::numeric_limits<juce::int32>::min() - bits : (juce::int64) bits;
+    };
+
+    return std::abs (toOrdered (a) - toOrdered (b));
+}
+
+Comparison compare (const juce::AudioBuffer<float>& actual, const juce::AudioBuffer<float>& expected,
+                    const Tolerance& tolerance, juce::AudioBuffer<float>& difference)
+{
+    Comparison comparison;
+
+    float peak = 0.0f;
+
+    for (int channel = 0; channel < expected.getNumChannels(); ++channel)
+        peak = juce::jmax (peak, expected.getMagnitude (channel, 0, expected.getNumSamples()));
+
+    const auto floor = juce::jmax (peak, 1.0f / 32768.0f) * juce::Decibels::decibelsToGain (tolerance.floorDb, -1000.0);
+    difference.setSize (expected.getNumChannels(), expected.getNumSamples());
+
+    for (int channel = 0; channel < expected.getNumChannels(); ++channel)
+    {
+        for (int i = 0; i < expected.getNumSamples(); ++i)
+        {
+            const auto a = actual.getSample (channel, i);
+            const auto e = expected.getSample (channel, i);
+            const auto error = std::abs ((double) a - (double) e);
+            const auto ulp = getUlpDistance (a, e);
+
+            difference.setSample (channel, i, a - e);
+            comparison.maxError = juce::jmax (comparison.maxError, error);
+            comparison.maxUlp = juce::jmax (comparison.maxUlp, ulp);
+
+            if (error > floor && ulp > tolerance.maxUlp)
+                ++comparison.numFailingSamples;
+        }
+    }
+
+    if (comparison.maxError > 0.0 && peak > 0.0f)
+        comparison.maxErrorDb = juce::Decibels::gainToDecibels (comparison.maxError / peak, -1000.0);
+
+    return comparison;
+}
+
+//==============================================================================
+bool writeWav (const juce::File& file, const juce::AudioBuffer<float>& buffer)
+{
+    file.deleteFile();
+    auto stream = file.createOutputStream();
+
+    if (stream == nullptr)
+        return false;
+
+    juce::WavAudioFormat format;
+    std::unique_ptr<juce::AudioFormatWriter> writer (format.createWriterFor (stream.get(), sampleRate, (unsigned int) buffer.getNumChannels(), 32, {}, 0));
+
+    if (writer == nullptr)
+        return false;
+
+    stream.release();   // the writer owns it now
+    return writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples());
+}
+
+bool readWav (const juce::File& file, juce::AudioBuffer<float>& buffer)
+{
+    juce::WavAudioFormat format;
+    std::unique_ptr<juce::AudioFormatReader> reader (format.createReaderFor (new juce::FileInputStream (file), true));
+
+    if (reader == nullptr)
+        return false;
+
+    buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+    return reader->read (&buffer, 0, buffer.getNumSamples(), 0, true, true);
+}
+} // namespace
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    Tolerance tolerance;
+
+    if (args.containsOption ("--ulp"))
+        tolerance.maxUlp = args.getValueForOption ("--ulp").getIntValue();
+
+    if (args.containsOption ("--db"))
+        tolerance.floorDb = args.getValueForOption ("--db").getDoubleValue();
+
+    const auto caseFilter = args.getValueForOption ("--case");
+    const auto record = args.containsOption ("--record");
+    const auto useReference = args.containsOption ("--reference");
+    const auto goldenDirectory = args.containsOption ("--golden") ? args.getFileForOption ("--golden") : juce::File();
+    const auto reportDirectory = args.containsOption ("--report") ? args.getFileForOption ("--report") : juce::File();
+
+    if (! useReference && goldenDirectory == juce::File())
+    {
+        std::cerr << "--golden=<dir> or --reference is needed" << std::endl;
+        return 1;
+    }
+
+    if (record && useReference)
+    {
+        std::cerr << "--record only writes processor renders, not --reference ones" << std::endl;
+        return 1;
+    }
+
+    if (record)
+        goldenDirectory.createDirectory();
+
+    std::unique_ptr<juce::FileOutputStream> summary;
+
+    if (reportDirectory != juce::File())
+    {
+        reportDirectory.createDirectory();
+        summary = reportDirectory.getChildFile ("summary.csv").createOutputStream();
+
+        if (summary == nullptr || ! summary->setPosition (0) || ! summary->truncate().wasOk())
+        {
+            std::cerr << "Can't write the report" << std::endl;
+            return 1;
+        }
+
+        *summary << "case,max_abs_error,max_error_db,max_ulp,failing_samples,result" << juce::newLine;
+    }
+
+    TestPlayHead playHead;
+    std::array<juce::AudioBuffer<float>, 3> stimuli { makeStimulus (Stimulus::impulse),
+                                                      makeStimulus (Stimulus::sweep),
+                                                      makeStimulus (Stimulus::noise) };
+    int numCases = 0, numFailures = 0;
+
+    for (const auto& renderCase : makeCases())
+    {
+        if (caseFilter.isNotEmpty() && ! renderCase.name.contains (caseFilter))
+            continue;
+
+        const auto& stimulus = stimuli[(size_t) renderCase.stimulus];
+        const auto goldenFile = goldenDirectory.getChildFile (renderCase.name + ".wav");
+        ++numCases;
+
+        if (record)
+        {
+            if (! writeWav (goldenFile, renderProcessor<float> (renderCase, stimulus, playHead)))
+            {
+                std::cerr << "Can't write " << goldenFile.getFullPathName() << std::endl;
+                return 1;
+            }
+
+            continue;
+        }
+
+        juce::AudioBuffer<float> expected;
+
+        if (useReference)
+        {
+            expected = renderReference (renderCase, stimulus, playHead.bpm);
+        }
+        else if (! readWav (goldenFile, expected))
+        {
+            std::cerr << "Missing golden render " << goldenFile.getFullPathName()
+                      << "; record the set with --golden=<dir> --record" << std::endl;
+            return 1;
+        }
+
+        // Both precisions are held to the same expected output.
+        for (const juce::String precision : { "float", "double" })
+        {
+            const auto actual = precision == "double" ? renderProcessor<double> (renderCase, stimulus, playHead)
+                                                      : renderProcessor<float>  (renderCase, stimulus, playHead);
+            const auto name = renderCase.name + "_" + precision;
+
+            juce::AudioBuffer<float> difference;
+            const auto comparison = compare (actual, expected, tolerance, difference);
+            const auto passed = comparison.numFailingSamples == 0;
+
+            if (! passed)
+            {
+                ++numFailures;
+                std::cout << "FAIL " << name << ": " << comparison.numFailingSamples << " samples out of tolerance, max error "
+                          << comparison.maxErrorDb << " dB, " << comparison.maxUlp << " ulp" << std::endl;
+
+                if (reportDirectory != juce::File())
+                    writeWav (reportDirectory.getChildFile (name + "_diff.wav"), difference);
+            }
+
+            if (summary != nullptr)
+                *summary << name << ',' << juce::String (comparison.maxError, 9) << ','
+                         << juce::String (comparison.maxErrorDb, 2) << ',' << juce::String (comparison.maxUlp) << ','
+                         << juce::String (comparison.numFailingSamples) << ',' << (passed ? "pass" : "fail") << juce::newLine;
+        }
+    }
+
+    if (record)
+    {
+        std::cout << "Recorded " << numCases << " golden renders to " << goldenDirectory.getFullPathName() << std::endl;
+        return 0;
+    }
+
+    std::cout << 2 * numCases - numFailures << " of " << 2 * numCases << " renders match" << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeGuard.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined (__linux__) && defined (__GLIBC__)
+ #define FILTERED_DELAY_GUARD_LIBC 1
+ #include <dlfcn.h>
+ #include <execinfo.h>
+ #include <pthread.h>
+ #include <unistd.h>
+
+// glibc's own entry points, so the replacements below don't call themselves.
+extern "C" void* __libc_malloc (size_t);
+extern "C" void* __libc_calloc (size_t, size_t);
+extern "C" void* __libc_realloc (void*, size_t);
+extern "C" void* __libc_memalign (size_t, size_t);
+extern "C" void  __libc_free (void*);
+#else
+ #define FILTERED_DELAY_GUARD_LIBC 0
+#endif
+
+namespace RealtimeGuard
+{
+namespace
+{
+    // Plain ints, so reading them never allocates thread-local storage.
+    thread_local int checkDepth = 0;
+    thread_local int reporting = 0;
+
+    void printStackTrace() noexcept
+    {
+       #if FILTERED_DELAY_GUARD_LIBC
+        void* frames[64];
+        const auto numFrames = backtrace (frames, 64);
+        backtrace_symbols_fd (frames, numFrames, STDERR_FILENO);
+       #endif
+    }
+}
+
+ScopedRealtimeCheck::ScopedRealtimeCheck() noexcept    { ++checkDepth; }
+ScopedRealtimeCheck::~ScopedRealtimeCheck() noexcept   { --checkDepth; }
+
+bool isChecking() noexcept
+{
+    return checkDepth > 0 && reporting == 0;
+}
+
+void check (const char* operation) noexcept
+{
+    if (! isChecking())
+        return;
+
+    // Reporting allocates, so switch the checks off for the rest of the run.
+    reporting = 1;
+    std::fprintf (stderr, "\nReal-time violation: %s on a guarded thread\n", operation);
+    printStackTrace();
+    std::fflush (stderr);
+    std::abort();
+}
+}
+
+//==============================================================================
+#if FILTERED_DELAY_GUARD_LIBC
+extern "C"
+{
+void* malloc (size_t size)
+{
+    RealtimeGuard::check ("malloc");
+    return __libc_malloc (size);
+}
+
+void* calloc (size_t count, size_t size)
+{
+    RealtimeGuard::check ("calloc");
+    return __libc_calloc (count, size);
+}
+
+void* realloc (void* pointer, size_t size)
+{
+    RealtimeGuard::check ("realloc");
+    return __libc_realloc (pointer, size);
+}
+
+void* aligned_alloc (size_t alignment, size_t size)
+{
+    RealtimeGuard::check ("aligned_alloc");
+    return __libc_memalign (alignment, size);
+}
+
+int posix_memalign (void** result, size_t alignment, size_t size)
+{
+    RealtimeGuard::check ("posix_memalign");
+    *result = __libc_memalign (alignment, size);
+    return *result != nullptr ? 0 : ENOMEM;
+}
+
+void free (void* pointer)
+{
+    if (pointer != nullptr)
+        RealtimeGuard::check ("free");
+
+    __libc_free (pointer);
+}
+
+int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    RealtimeGuard::check ("pthread_mutex_lock");
+
+    using Function = int (*) (pthread_mutex_t*);
+    static const auto next = reinterpret_cast<Function> (dlsym (RTLD_NEXT, "pthread_mutex_lock"));
+    return next (mutex);
+}
+
+int pthread_mutex_trylock (pthread_mutex_t* mutex)
+{
+    RealtimeGuard::check ("pthread_mutex_trylock");
+
+    using Function = int (*) (pthread_mutex_t*);
+    static const auto next = reinterpret_cast<Function> (dlsym (RTLD_NEXT, "pthread_mutex_trylock"));
+    return next (mutex);
+}
+}
+#endif
+
+//==============================================================================
+namespace
+{
+    void* allocate (std::size_t size, const char* operation)
+    {
+        RealtimeGuard::check (operation);
+
+        if (auto* pointer = std::malloc (size == 0 ? 1 : size))
+            return pointer;
+
+        throw std::bad_alloc();
+    }
+
+    void* allocateAligned (std::size_t size, std::align_val_t alignment, const char* operation)
+    {
+        RealtimeGuard::check (operation);
+
+       #if FILTERED_DELAY_GUARD_LIBC
+        if (auto* pointer = __libc_memalign ((size_t) alignment, size == 0 ? 1 : size))
+            return pointer;
+       #else
+        const auto align = (std::size_t) alignment;
+
+        if (auto* pointer = std::aligned_alloc (align, (size + align - 1) / align * align))
+            return pointer;
+       #endif
+
+        throw std::bad_alloc();
+    }
+
+    void deallocate (void* pointer, const char* operation) noexcept
+    {
+        if (pointer != nullptr)
+            RealtimeGuard::check (operation);
+
+        std::free (pointer);
+    }
+}
+
+void* operator new (std::size_t size)                                   { return allocate (size, "operator new"); }
+void* operator new[] (std::size_t size)                                 { return allocate (size, "operator new[]"); }
+void* operator new (std::size_t size, std::align_val_t alignment)       { return allocateAligned (size, alignment, "operator new"); }
+void* operator new[] (std::size_t size, std::align_val_t alignment)     { return allocateAligned (size, alignment, "operator new[]"); }
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate (size, "operator new"); } catch (...) { return nullptr; }
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate (size, "operator new[]"); } catch (...) { return nullptr; }
+}
+
+void operator delete (void* pointer) noexcept                                    { deallocate (pointer, "operator delete"); }
+void operator delete[] (void* pointer) noexcept                                  { deallocate (pointer, "operator delete[]"); }
+void operator delete (void* pointer, std::size_t) noexcept                       { deallocate (pointer, "operator delete"); }
+void operator delete[] (void* pointer, std::size_t) noexcept                     { deallocate (pointer, "operator delete[]"); }
+void operator delete (void* pointer, std::align_val_t) noexcept                  { deallocate (pointer, "operator delete"); }
+void operator delete[] (void* pointer, std::align_val_t) noexcept                { deallocate (pointer, "operator delete[]"); }
+void operator delete (void* pointer, std::size_t, std::align_val_t) noexcept     { deallocate (pointer, "operator delete"); }
+void operator delete[] (void* pointer, std::size_t, std::align_val_t) noexcept   { deallocate (pointer, "operator delete[]"); }
@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.h
+
+    Fails the test run when guarded code allocates or takes a lock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+//==============================================================================
+/**
+    Catches allocations and lock acquisitions on a guarded thread.
+
+    Linking RealtimeGuard.cpp into an executable replaces the global operator
+    new and delete, and on Linux also the malloc family, free,
+    pthread_mutex_lock and pthread_mutex_trylock. They behave as usual
+    unless the calling thread is inside a ScopedRealtimeCheck, in which case
+    the call is reported with a stack trace and the process aborts.
+
+    Only the thread that opened the scope is checked, so worker threads and
+    anything the test does outside the scope are unaffected.
+*/
+namespace RealtimeGuard
+{
+    /** Checks the current thread for as long as it exists. Scopes may nest. */
+    class ScopedRealtimeCheck
+    {
+    public:
+        ScopedRealtimeCheck() noexcept;
+        ~ScopedRealtimeCheck() noexcept;
+
+        ScopedRealtimeCheck (const ScopedRealtimeCheck&) = delete;
+        ScopedRealtimeCheck& operator= (const ScopedRealtimeCheck&) = delete;
+    };
+
+    /** True while the current thread is inside a ScopedRealtimeCheck. */
+    bool isChecking() noexcept;
+
+    /** Reports a violation on the current thread and aborts if it is being checked. */
+    void check (const char* operation) noexcept;
+}
@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+    Sweeps every parameter while processBlock runs under RealtimeGuard.
+
+    For each bus configuration below, in both single and double precision,
+    every parameter in createParameters() is stepped across its range. At
+    each step the few processBlock calls that pick the new value up run
+    inside a ScopedRealtimeCheck, so any allocation or lock on the audio
+    path aborts the run with a stack trace.
+    Every program is then selected in turn, and the blocks that crossfade it
+    in are checked the same way, as are the blocks that switch the long
+    delay history in and out.
+
+    The host-side notification that delivers the change
+    (setValueNotifyingHost) runs outside the check: it takes JUCE's own
+    parameter listener lock, which is out of this plugin's hands.
+
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+#include "RealtimeGuard.h"
+
+#include <iostream>
+
+namespace
+{
+//==============================================================================
+struct TestPlayHead  : public juce::AudioPlayHead
+{
+    juce::Optional<PositionInfo> getPosition() const override
+    {
+        PositionInfo info;
+        info.setBpm (bpm);
+        info.setIsPlaying (true);
+        return info;
+    }
+
+    double bpm = 120.0;
+};
+
+struct Configuration
+{
+    double sampleRate;
+    int blockSize;
+    int numChannels;
+};
+
+constexpr Configuration configurations[]
+{
+    { 44100.0,  64,  2 },
+    { 48000.0, 512,  1 },
+    { 96000.0, 128, 12 },
+    { 48000.0, 256, 36 }     // past the 32 channels an AudioBuffer holds without allocating
+};
+
+constexpr int stepsPerParameter = 8;
+constexpr int blocksPerStep = 4;
+
+//==============================================================================
+template <typename SampleType>
+void fillWithNoise (juce::AudioBuffer<SampleType>& buffer, juce::Random& random)
+{
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+            buffer.setSample (channel, sample, static_cast<SampleType> ((random.nextFloat() * 2.0f - 1.0f) * 0.25f));
+}
+
+juce::RangedAudioParameter* findParameter (juce::AudioProcessor& processor, const juce::String& parameterID)
+{
+    for (auto* parameter : processor.getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter))
+            if (ranged->getParameterID() == parameterID)
+                return ranged;
+
+    return nullptr;
+}
+
+template <typename SampleType>
+void runConfiguration (const Configuration& configuration, TestPlayHead& playHead)
+{
+    FilteredDelayAudioProcessor processor;
+    processor.setProcessingPrecision (std::is_same_v<SampleType, double> ? juce::AudioProcessor::doublePrecision
+                                                                          : juce::AudioProcessor::singlePrecision);
+    processor.setPlayHead (&playHead);
+    processor.setPlayConfigDetails (configuration.numChannels, configuration.numChannels,
+                                    configuration.sampleRate, configuration.blockSize);
+    processor.prepareToPlay (configuration.sampleRate, configuration.blockSize);
+
+    juce::AudioBuffer<SampleType> buffer (configuration.numChannels, configuration.blockSize);
+    juce::MidiBuffer midi;
+    juce::Random random (0x5eed);
+
+    auto process = [&] (juce::AudioBuffer<SampleType>& block)
+    {
+        fillWithNoise (block, random);
+
+        const RealtimeGuard::ScopedRealtimeCheck check;
+        processor.processBlock (block, midi);
+    };
+
+    for (auto* parameter : processor.getParameters())
+    {
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter);
+
+        if (ranged == nullptr)
+            continue;
+
+        for (int step = 0; step < stepsPerParameter; ++step)
+        {
+            const auto normalisedValue = (float) step / (float) (stepsPerParameter - 1);
+            ranged->setValueNotifyingHost (normalisedValue);
+
+            for (int block = 0; block < blocksPerStep; ++block)
+                process (buffer);
+        }
+
+        ranged->setValueNotifyingHost (ranged->getDefaultValue());
+    }
+
+    // Program changes are written outside the check, like parameter changes,
+    // and crossfaded in by the blocks that follow.
+    for (int program = 0; program < processor.getNumPrograms(); ++program)
+    {
+        processor.setCurrentProgram (program);
+
+        for (int block = 0; block < blocksPerStep; ++block)
+            process (buffer);
+    }
+
+    // Blocks longer than prepared are split inside processBlock.
+    juce::AudioBuffer<SampleType> oversizedBuffer (configuration.numChannels, configuration.blockSize * 3 + 7);
+    process (oversizedBuffer);
+
+    // The long delay history is allocated off the audio thread, here by
+    // prepareToPlay since nothing runs the message loop, and the blocks only
+    // switch it in and out.
+    auto* longDelay = findParameter (processor, "LONG_DELAY");
+    auto* longRate = findParameter (processor, "LONG_RATE");
+    jassert (longDelay != nullptr && longRate != nullptr);
+
+    longDelay->setValueNotifyingHost (1.0f);
+    longRate->setValueNotifyingHost (1.0f);
+    processor.prepareToPlay (configuration.sampleRate, configuration.blockSize);
+
+    for (int block = 0; block < blocksPerStep; ++block)
+        process (buffer);
+
+    longDelay->setValueNotifyingHost (0.0f);
+
+    for (int block = 0; block < blocksPerStep; ++block)
+        process (buffer);
+
+    processor.releaseResources();
+}
+} // namespace
+
+//==============================================================================
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    TestPlayHead playHead;
+
+    for (const auto& configuration : configurations)
+    {
+        for (const juce::String precision : { "float", "double" })
+        {
+            if (precision == "double")
+                runConfiguration<double> (configuration, playHead);
+            else
+                runConfiguration<float> (configuration, playHead);
+
+            std::cout << configuration.numChannels << " channels at " << configuration.sampleRate << " Hz, "
+                      << configuration.blockSize << " samples, " << precision << ": no allocations or locks" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    ReferenceDelay.h
+
+    A plain per-sample model of the delay loop, for regression tests.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+//==============================================================================
+/**
+    One channel of the delay, filter and feedback loop, written as directly as
+    possible from the plugin's description: one sample at a time, no chunking,
+    no interleaving, no SIMD and nothing shared with the plugin's DSP code.
+
+    It follows the signal flow described for DelayEngine with modulation,
+    taps and oversampling off and linear interpolation:
+
+        write  = input - feedbackSample
+        wet    = filter (read (delay))
+        output = wet + feedbackSample
+        feedbackSample = output * feedback * 0.5
+
+    The filter is the TPT state variable filter. The delay is fixed from the
+    first sample, as it is for a processor prepared with its settings already
+    in place.
+*/
+template <typename SampleType>
+class ReferenceDelay
+{
+public:
+    enum class FilterType { lowpass, highpass, bandpass };
+
+    ReferenceDelay (double sampleRate, double delayInSamples, FilterType type,
+                    double cutoffHz, double resonance, double feedbackAmount)
+        : buffer ((size_t) std::ceil (delayInSamples) + 2),
+          filterType (type),
+          feedback (static_cast<SampleType> (feedbackAmount)),
+          delay (static_cast<SampleType> (delayInSamples))
+    {
+        // The coefficients are worked out in double precision, as in the plugin.
+        const auto pi = 3.141592653589793238;
+        const auto cutoff = std::fmin (cutoffHz, sampleRate * 0.49);
+        const auto clampedResonance = std::fmax (0.05, resonance);
+        const auto gDouble = std::tan (pi * cutoff / sampleRate);
+        const auto R2Double = 1.0 / clampedResonance;
+
+        g  = static_cast<SampleType> (gDouble);
+        R2 = static_cast<SampleType> (R2Double);
+        h  = static_cast<SampleType> (1.0 / (1.0 + R2Double * gDouble + gDouble * gDouble));
+    }
+
+    SampleType processSample (SampleType input)
+    {
+        writeIndex = (writeIndex + 1) % (int) buffer.size();
+        buffer[(size_t) writeIndex] = input - feedbackSample;
+
+        const auto wet = filter (read (delay));
+        const auto output = wet + feedbackSample;
+        feedbackSample = output * feedback * static_cast<SampleType> (0.5);
+        return output;
+    }
+
+private:
+    SampleType at (int delayInSamples) const
+    {
+        const auto size = (int) buffer.size();
+        return buffer[(size_t) (((writeIndex - delayInSamples) % size + size) % size)];
+    }
+
+    SampleType read (SampleType delayInSamples) const
+    {
+        const auto whole = (int) delayInSamples;
+        const auto fraction = delayInSamples - static_cast<SampleType> (whole);
+        const auto first = at (whole);
+        return first + fraction * (at (whole + 1) - first);
+    }
+
+    SampleType filter (SampleType input)
+    {
+        const auto highpass = h * (input - s1 * (g + R2) - s2);
+        const auto bandpass = highpass * g + s1;
+        s1 = highpass * g + bandpass;
+        const auto lowpass = bandpass * g + s2;
+        s2 = bandpass * g + lowpass;
+
+        switch (filterType)
+        {
+            case FilterType::lowpass:  return lowpass;
+            case FilterType::highpass: return highpass;
+            case FilterType::bandpass: return bandpass;
+        }
+
+        return lowpass;
+    }
+
+    std::vector<SampleType> buffer;
+    int writeIndex = 0;
+
+    FilterType filterType;
+    SampleType g {}, R2 {}, h {}, s1 {}, s2 {};
+
+    SampleType feedback;
+    SampleType feedbackSample {};
+
+    SampleType delay;
+};